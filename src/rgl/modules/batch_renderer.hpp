@@ -0,0 +1,260 @@
+#pragma once
+
+#include "gl_functions.hpp"
+#include "index_buffer.hpp"
+#include "indirect_buffer.hpp"
+#include "vertex_array.hpp"
+#include "vertex_buffer.hpp"
+#include "vertex_buffer_layout.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+namespace rgl {
+
+/**
+ * @brief Location of a mesh inside the shared buffers of a batch renderer.
+ *
+ */
+struct BatchMesh {
+    std::uint32_t index_count{};
+    std::uint32_t first_index{};
+    std::int32_t base_vertex{};
+};
+
+/**
+ * @brief Batch renderer built on multi-draw-indirect.
+ *
+ * @details Packs the vertices and indices of many meshes sharing the same
+ * vertex layout into a single vertex buffer and a single index buffer, owned
+ * by a single vertex array. Draws are recorded as indirect commands and
+ * submitted all at once through glMultiDrawElementsIndirect, so drawing
+ * thousands of small meshes costs one vertex array bind and one draw call.
+ *
+ * Meshes are added with add_mesh(), which only appends to CPU-side arenas, and
+ * become drawable after commit() uploads the arenas. Every frame, draws are
+ * recorded with submit() and issued with draw().
+ *
+ * Per-draw data can be fetched in the shaders through `gl_DrawID` or through
+ * an instance buffer set on vertex_array(), indexed with the `base_instance`
+ * given to submit().
+ *
+ * @note Indices are relative to the mesh they belong to, base vertices are
+ * handled by the renderer.
+ *
+ * @see rgl::IndirectBuffer
+ * @see https://www.khronos.org/opengl/wiki/Vertex_Rendering#Indirect_rendering
+ */
+class BatchRenderer {
+public:
+    /**
+     * @brief Identifier of a mesh added to the batch renderer.
+     *
+     */
+    using MeshId = std::uint32_t;
+
+    /**
+     * @brief Construct a new batch renderer object
+     *
+     * @param layout the vertex layout shared by every mesh of the batch.
+     */
+    BatchRenderer(const VertexBufferLayout& layout) noexcept;
+
+    BatchRenderer(const BatchRenderer&) = delete;
+    auto operator=(const BatchRenderer&) -> BatchRenderer& = delete;
+
+    BatchRenderer(BatchRenderer&&) noexcept = default;
+    auto operator=(BatchRenderer&&) noexcept -> BatchRenderer& = default;
+
+    ~BatchRenderer() = default;
+
+    /**
+     * @brief Add a mesh to the batch.
+     *
+     * @note The mesh can only be drawn after the next call to commit().
+     *
+     * @param vertices the vertices of the mesh, laid out according to the
+     * layout of the batch.
+     * @param indices the indices of the mesh, relative to its first vertex.
+     * @return MeshId the identifier of the mesh, to be given to submit().
+     */
+    auto add_mesh(std::span<const float> vertices,
+                  std::span<const std::uint32_t> indices) -> MeshId;
+
+    /**
+     * @brief Add a mesh given as raw bytes, for layouts holding half float,
+     * normalized or integer attributes.
+     *
+     * @note The size of the vertices must be a multiple of the stride of the
+     * layout, so that the following meshes start on a vertex boundary.
+     *
+     */
+    auto add_mesh(std::span<const std::byte> vertices,
+                  std::span<const std::uint32_t> indices) -> MeshId;
+
+    /**
+     * @brief Upload the meshes added since the last commit.
+     *
+     * @details The buffers keep their ids, so the vertex array does not need
+     * to be set up again.
+     */
+    void commit();
+
+    /**
+     * @brief Record a draw of a mesh.
+     *
+     * @param mesh the identifier of the mesh to draw.
+     * @param instance_count the number of instances to draw.
+     * @param base_instance the first instance to draw, offsets the instanced
+     * attributes and `gl_BaseInstance`.
+     */
+    void submit(MeshId mesh, std::uint32_t instance_count = 1,
+                std::uint32_t base_instance = 0);
+
+    /**
+     * @brief Issue every recorded draw with a single indirect multi-draw, and
+     * clear them.
+     *
+     * @note Binds the vertex array and the indirect buffer.
+     *
+     * @param mode the primitive type, defaults to GL_TRIANGLES.
+     */
+    void draw(std::uint32_t mode = GL_TRIANGLES);
+
+    /**
+     * @brief Discard every recorded draw.
+     *
+     */
+    void clear() { commands_.clear(); }
+
+    // UTILITIES
+
+    /**
+     * @brief Get the location of a mesh in the shared buffers.
+     *
+     */
+    [[nodiscard]] auto mesh(MeshId id) const -> const BatchMesh& {
+        return meshes_[id];
+    }
+
+    [[nodiscard]] auto mesh_count() const noexcept -> std::size_t {
+        return meshes_.size();
+    }
+
+    /**
+     * @brief Get the draws recorded since the last draw().
+     *
+     */
+    [[nodiscard]] auto commands() const noexcept
+        -> std::span<const DrawElementsIndirectCommand> {
+        return commands_;
+    }
+
+    /**
+     * @brief Get the vertex array holding the shared buffers, for instance to
+     * set an instance buffer.
+     *
+     */
+    [[nodiscard]] auto vertex_array() noexcept -> VertexArray& {
+        return vao_;
+    }
+
+    [[nodiscard]] auto indirect_buffer() noexcept -> IndirectBuffer& {
+        return indirect_;
+    }
+
+private:
+    VertexBufferLayout layout_;
+    VertexArray vao_;
+    IndirectBuffer indirect_;
+
+    std::vector<std::byte> vertices_;
+    std::vector<std::uint32_t> indices_;
+    std::vector<BatchMesh> meshes_;
+    std::vector<DrawElementsIndirectCommand> commands_;
+
+    bool dirty_{false};
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+inline BatchRenderer::BatchRenderer(const VertexBufferLayout& layout) noexcept
+    : layout_{layout} {
+    vao_.add_vertex_buffer(
+        VertexBuffer{std::span<const float>{}, layout_,
+                     DriverDrawHint::STATIC_DRAW});
+    vao_.set_index_buffer(IndexBuffer{std::span<const std::uint32_t>{}});
+}
+
+inline auto BatchRenderer::add_mesh(std::span<const float> vertices,
+                                    std::span<const std::uint32_t> indices)
+    -> MeshId {
+    return add_mesh(std::as_bytes(vertices), indices);
+}
+
+inline auto BatchRenderer::add_mesh(std::span<const std::byte> vertices,
+                                    std::span<const std::uint32_t> indices)
+    -> MeshId {
+    std::size_t const stride = layout_.stride();
+#ifdef RGL_DEBUG
+    if (stride == 0 || vertices.size() % stride != 0) {
+        std::fprintf(stderr,
+                     RGL_LINEINFO
+                     ", mesh of %zu bytes does not hold whole vertices of "
+                     "%zu bytes\n",
+                     vertices.size(), stride);
+    }
+#endif  // RGL_DEBUG
+
+    // an empty layout has no vertices to offset
+    meshes_.push_back(
+        {static_cast<std::uint32_t>(indices.size()),
+         static_cast<std::uint32_t>(indices_.size()),
+         stride == 0 ? 0
+                     : static_cast<std::int32_t>(vertices_.size() / stride)});
+
+    vertices_.insert(vertices_.end(), vertices.begin(), vertices.end());
+    indices_.insert(indices_.end(), indices.begin(), indices.end());
+    dirty_ = true;
+
+    return static_cast<MeshId>(meshes_.size() - 1);
+}
+
+inline void BatchRenderer::commit() {
+    if (!dirty_) {
+        return;
+    }
+
+    vao_.buffers_data().front().set_data(
+        std::span<const std::byte>{vertices_});
+    vao_.index_data().set_data(indices_);
+
+    dirty_ = false;
+}
+
+inline void BatchRenderer::submit(MeshId mesh, std::uint32_t instance_count,
+                                  std::uint32_t base_instance) {
+    auto const& [index_count, first_index, base_vertex] = meshes_[mesh];
+    commands_.push_back({index_count, instance_count, first_index, base_vertex,
+                         base_instance});
+}
+
+inline void BatchRenderer::draw(std::uint32_t mode) {
+    if (commands_.empty()) {
+        return;
+    }
+
+    indirect_.set_data(commands_);
+    vao_.draw_indirect(indirect_, 0, commands_.size(), mode);
+
+    commands_.clear();
+}
+
+}  // namespace rgl
\ No newline at end of file
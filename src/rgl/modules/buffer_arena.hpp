@@ -0,0 +1,242 @@
+#pragma once
+
+#include "gl_functions.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <span>
+
+namespace rgl {
+
+/**
+ * @brief A range of bytes allocated from a buffer arena.
+ *
+ */
+struct ArenaRange {
+    std::size_t offset{};
+    std::size_t size{};
+};
+
+/**
+ * @brief Suballocating arena over a single immutable GL buffer.
+ *
+ * @details Creating a buffer object per mesh means thousands of buffer objects
+ * for thousands of small meshes, and a vertex array rebind for each of them.
+ * The arena instead allocates one large buffer with glBufferStorage and hands
+ * out byte ranges of it, tracked by a free list ordered by offset, neighbouring
+ * free ranges being merged back together on deallocation.
+ *
+ * Vertex and index buffers can be created as views into an arena (see the
+ * arena constructors of rgl::VertexBuffer and rgl::IndexBuffer). Vertex views
+ * are aligned to their stride, so every mesh sharing a layout can be drawn
+ * through a single vertex array (see VertexArray::set_arena()) with
+ * base-vertex draws. Vertices and indices can live in the same arena.
+ *
+ * @note The arena does not grow, allocate() returns std::nullopt once it is
+ * full, at which point another arena can be created.
+ *
+ * @warning Views keep a pointer to their arena, which must therefore outlive
+ * them, and is neither copyable nor movable.
+ *
+ * @see https://www.khronos.org/opengl/wiki/Buffer_Object#Immutable_Storage
+ */
+class BufferArena {
+public:
+    /**
+     * @brief Construct a new buffer arena object
+     *
+     * @param size the size of the arena, in bytes.
+     */
+    BufferArena(std::size_t size) noexcept;
+
+    ~BufferArena();
+
+    BufferArena(const BufferArena&) = delete;
+    auto operator=(const BufferArena&) -> BufferArena& = delete;
+
+    BufferArena(BufferArena&&) = delete;
+    auto operator=(BufferArena&&) -> BufferArena& = delete;
+
+    /**
+     * @brief Allocate a range of the arena.
+     *
+     * @details First-fit allocation, the padding needed to honor the alignment
+     * is kept in the free list.
+     *
+     * @param size the size of the range, in bytes.
+     * @param alignment the alignment of the offset of the range, in bytes,
+     * does not need to be a power of two (vertex strides seldom are).
+     * @return std::optional<ArenaRange> the allocated range, std::nullopt if no
+     * free range is large enough.
+     */
+    [[nodiscard]] auto allocate(std::size_t size, std::size_t alignment = 4)
+        -> std::optional<ArenaRange>;
+
+    /**
+     * @brief Give a range back to the arena.
+     *
+     * @param range a range obtained from allocate().
+     */
+    void deallocate(ArenaRange range);
+
+    /**
+     * @brief Write data into the arena.
+     *
+     * @param offset the offset of the data in the arena, in bytes.
+     * @param data the data to write.
+     */
+    void write(std::size_t offset, std::span<const std::byte> data) const;
+
+    // UTILITIES
+
+    [[nodiscard]] constexpr auto id() const noexcept -> std::uint32_t {
+        return id_;
+    }
+
+    /**
+     * @brief Get the size of the arena, in bytes.
+     *
+     */
+    [[nodiscard]] constexpr auto size() const noexcept -> std::size_t {
+        return size_;
+    }
+
+    /**
+     * @brief Get the number of bytes not allocated, possibly fragmented.
+     *
+     */
+    [[nodiscard]] constexpr auto free_bytes() const noexcept -> std::size_t {
+        return free_bytes_;
+    }
+
+    /**
+     * @brief Get the size of the largest free range, in bytes.
+     *
+     */
+    [[nodiscard]] auto largest_free_range() const noexcept -> std::size_t;
+
+private:
+    std::uint32_t id_{};
+    std::size_t size_{};
+    std::size_t free_bytes_{};
+
+    // free ranges, offset -> size, never adjacent to each other
+    std::map<std::size_t, std::size_t> free_;
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+inline BufferArena::BufferArena(std::size_t size) noexcept
+    : size_{size},
+      free_bytes_{size} {
+    glCreateBuffers(1, &id_);
+    glNamedBufferStorage(
+        id_, static_cast<ptrdiff_t>(size_), nullptr,
+        GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT | GL_MAP_WRITE_BIT);
+
+    if (size_ != 0) {
+        free_.emplace(0, size_);
+    }
+}
+
+inline BufferArena::~BufferArena() {
+    if (id_ != 0) {
+        glDeleteBuffers(1, &id_);
+    }
+}
+
+inline auto BufferArena::allocate(std::size_t size, std::size_t alignment)
+    -> std::optional<ArenaRange> {
+    if (size == 0) {
+        return ArenaRange{};
+    }
+    if (alignment == 0) {
+        alignment = 1;
+    }
+
+    for (auto it = free_.begin(); it != free_.end(); ++it) {
+        auto const [block_offset, block_size] = *it;
+        std::size_t const offset =
+            (block_offset + alignment - 1) / alignment * alignment;
+        std::size_t const padding = offset - block_offset;
+
+        if (padding + size > block_size) {
+            continue;
+        }
+
+        free_.erase(it);
+        if (padding != 0) {
+            free_.emplace(block_offset, padding);
+        }
+        if (padding + size != block_size) {
+            free_.emplace(offset + size, block_size - padding - size);
+        }
+
+        free_bytes_ -= size;
+        return ArenaRange{offset, size};
+    }
+
+#ifdef RGL_DEBUG
+    std::fprintf(stderr,
+                 RGL_LINEINFO
+                 ", arena out of memory, %zu bytes requested, %zu bytes free\n",
+                 size, free_bytes_);
+#endif  // RGL_DEBUG
+
+    return std::nullopt;
+}
+
+inline void BufferArena::deallocate(ArenaRange range) {
+    if (range.size == 0) {
+        return;
+    }
+
+    free_bytes_ += range.size;
+    auto it = free_.emplace(range.offset, range.size).first;
+
+    // merge with the following free range
+    if (auto next = std::next(it);
+        next != free_.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        free_.erase(next);
+    }
+
+    // merge with the preceding free range
+    if (it != free_.begin()) {
+        if (auto prev = std::prev(it);
+            prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            free_.erase(it);
+        }
+    }
+}
+
+inline void BufferArena::write(std::size_t offset,
+                               std::span<const std::byte> data) const {
+    if (data.empty()) {
+        return;
+    }
+
+    glNamedBufferSubData(id_, static_cast<ptrdiff_t>(offset),
+                         static_cast<ptrdiff_t>(data.size()), data.data());
+}
+
+inline auto BufferArena::largest_free_range() const noexcept -> std::size_t {
+    std::size_t largest{};
+    for (const auto& [offset, size] : free_) {
+        largest = std::max(largest, size);
+    }
+
+    return largest;
+}
+
+}  // namespace rgl
\ No newline at end of file
@@ -0,0 +1,332 @@
+#pragma once
+
+#include "gl_functions.hpp"
+#include "indirect_buffer.hpp"
+#include "shader.hpp"
+#include "shader_storage_buffer.hpp"
+#include "vertex_buffer_inst.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string_view>
+
+namespace rgl {
+
+/**
+ * @brief GPU-driven frustum culling of instances.
+ *
+ * @details Runs a compute pass that tests the bounding sphere of every instance
+ * of an instance buffer against the six planes of the view frustum. The
+ * instances that pass the test are compacted into a second instance buffer,
+ * and their number is written directly into the `instance_count` of an
+ * indirect draw command, so the draw can be issued with
+ * VertexArray::draw_indirect() without any CPU readback.
+ *
+ * The bounding spheres live in a shader storage buffer, one `vec4` per
+ * instance holding the world space center in `xyz` and the radius in `w`. They
+ * must follow the order of the instances, including after deletions.
+ *
+ * Typical usage, once per frame:
+ *
+ * @code
+ * culler.cull(instances, spheres, FrustumCuller::extract_planes(view_proj),
+ *             vao.instanced_data().value(), commands, mesh_command);
+ * vao.draw_indirect(commands);
+ * @endcode
+ *
+ * @note The order of the visible instances is not preserved.
+ *
+ * @see rgl::ShaderStorageBuffer
+ * @see rgl::IndirectBuffer
+ */
+class FrustumCuller {
+public:
+    /**
+     * @brief Number of instances tested by a single work group.
+     *
+     */
+    static constexpr std::uint32_t workgroup_size = 64;
+
+    /**
+     * @brief Construct a new frustum culler object, compiling its compute
+     * shader.
+     *
+     */
+    FrustumCuller() noexcept;
+
+    FrustumCuller(const FrustumCuller&) = delete;
+    auto operator=(const FrustumCuller&) -> FrustumCuller& = delete;
+
+    FrustumCuller(FrustumCuller&&) noexcept = default;
+    auto operator=(FrustumCuller&&) noexcept -> FrustumCuller& = default;
+
+    ~FrustumCuller() = default;
+
+    /**
+     * @brief Extract the normalized frustum planes of a view-projection matrix.
+     *
+     * @details Planes are stored as `(a, b, c, d)` quadruplets, in the order
+     * left, right, bottom, top, near, far, with their normals pointing inside
+     * the frustum.
+     *
+     * @param view_projection the column-major view-projection matrix.
+     * @return std::array<float, 24> the six planes.
+     */
+    [[nodiscard]] static auto extract_planes(
+        std::span<const float, 16> view_projection) noexcept
+        -> std::array<float, 24>;
+
+    /**
+     * @brief Cull the instances of an instance buffer against a frustum.
+     *
+     * @details Writes `command` into `commands` at `command_index`, with its
+     * instance count reset to zero, then dispatches the culling pass, which
+     * copies each visible instance into `visible`, starting at
+     * `command.base_instance`, and increments the instance count of the
+     * command.
+     *
+     * @note Deferred instance buffers must be flushed before culling. The
+     * visible buffer is grown if needed, it must use the buffered storage as
+     * its contents are written by the GPU, and must not be edited through the
+     * instance API, which would overwrite them.
+     *
+     * @warning The indirect buffer is reallocated, losing its contents, if it
+     * cannot hold `command_index + 1` commands, reserve it beforehand when it
+     * holds several commands.
+     *
+     * @param instances the instances to cull.
+     * @param spheres the bounding spheres of the instances.
+     * @param planes the frustum planes, see extract_planes().
+     * @param visible the instance buffer receiving the visible instances, with
+     * the same layout as `instances`.
+     * @param commands the indirect buffer receiving the draw command.
+     * @param command the draw command of the mesh the instances belong to.
+     * @param command_index the index of the command in `commands`.
+     */
+    void cull(const VertexBufferInst& instances,
+              const ShaderStorageBuffer& spheres,
+              std::span<const float, 24> planes, VertexBufferInst& visible,
+              IndirectBuffer& commands, DrawElementsIndirectCommand command,
+              std::uint32_t command_index = 0);
+
+    // UTILITIES
+
+    [[nodiscard]] auto program() noexcept -> ShaderProgram& {
+        return program_;
+    }
+
+private:
+    static constexpr std::string_view cull_source{R"(#version 460 core
+layout(local_size_x = 64) in;
+
+// instances are copied as raw words, so that integer and packed attributes
+// are not altered by float loads and stores
+layout(std430, binding = 0) readonly buffer Instances { uint src[]; };
+layout(std430, binding = 1) readonly buffer Spheres { vec4 spheres[]; };
+layout(std430, binding = 2) writeonly buffer Visible { uint dst[]; };
+layout(std430, binding = 3) buffer Commands { uint commands[]; };
+
+uniform vec4 u_planes[6];
+uniform int u_instance_count;
+uniform int u_stride;
+uniform int u_src_offset;
+uniform int u_dst_offset;
+uniform int u_command;
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= uint(u_instance_count)) {
+        return;
+    }
+
+    vec4 sphere = spheres[id];
+    for (int i = 0; i < 6; ++i) {
+        if (dot(u_planes[i].xyz, sphere.xyz) + u_planes[i].w < -sphere.w) {
+            return;
+        }
+    }
+
+    // instance_count is the second member of the command
+    uint slot = atomicAdd(commands[u_command * 5 + 1], 1u);
+
+    uint stride = uint(u_stride);
+    uint from = uint(u_src_offset) + id * stride;
+    uint to = uint(u_dst_offset) + slot * stride;
+    for (uint i = 0u; i < stride; ++i) {
+        dst[to + i] = src[from + i];
+    }
+}
+)"};
+
+    ShaderProgram program_;
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+namespace detail {
+
+/**
+ * @brief Prepare a compute pass copying instances word by word from an
+ * instance buffer into another one, as run by rgl::FrustumCuller and
+ * rgl::LodSelector.
+ *
+ * @details Binds the instances, their bounding spheres, the destination and
+ * the indirect commands to the shader storage bindings 0 to 3, then binds the
+ * program and sets its `u_planes`, `u_instance_count`, `u_stride`,
+ * `u_src_offset`, `u_dst_offset` and `u_command` uniforms, the destination
+ * offset being the one of `base_instance`.
+ *
+ * @return true if the pass has to be dispatched, false if there are no
+ * instances or they cannot be copied word by word.
+ */
+inline auto begin_instance_copy(ShaderProgram& program,
+                                const VertexBufferInst& instances,
+                                const ShaderStorageBuffer& spheres,
+                                std::span<const float, 24> planes,
+                                const VertexBufferInst& destination,
+                                const IndirectBuffer& commands,
+                                std::uint32_t base_instance,
+                                std::uint32_t command_index) -> bool {
+    static constexpr std::array<std::string_view, 6> plane_names{
+        "u_planes[0]", "u_planes[1]", "u_planes[2]",
+        "u_planes[3]", "u_planes[4]", "u_planes[5]"};
+
+    if (instances.instance_size() % sizeof(std::uint32_t) != 0) [[unlikely]] {
+#ifdef RGL_DEBUG
+        std::fprintf(stderr,
+                     RGL_LINEINFO
+                     ", instance size %zu is not a multiple of 4 bytes\n",
+                     instances.instance_size());
+#endif  // RGL_DEBUG
+        return false;
+    }
+
+    auto const count = static_cast<std::uint32_t>(instances.instance_count());
+    if (count == 0) {
+        return false;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instances.id());
+    spheres.bind_base(1);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, destination.id());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, commands.id());
+
+    auto const stride = static_cast<std::int32_t>(instances.instance_size() /
+                                                  sizeof(std::uint32_t));
+
+    program.bind();
+    for (std::size_t i = 0; i < plane_names.size(); ++i) {
+        program.set_uniform4f(plane_names[i], planes[i * 4], planes[i * 4 + 1],
+                              planes[i * 4 + 2], planes[i * 4 + 3]);
+    }
+    program.set_uniform1i("u_instance_count", static_cast<int>(count));
+    program.set_uniform1i("u_stride", stride);
+    program.set_uniform1i(
+        "u_src_offset",
+        static_cast<int>(instances.offset() / sizeof(std::uint32_t)));
+    program.set_uniform1i("u_dst_offset",
+                          static_cast<int>(base_instance) * stride);
+    program.set_uniform1i("u_command", static_cast<int>(command_index));
+
+    return true;
+}
+
+/**
+ * @brief Dispatch a pass prepared by begin_instance_copy(), one invocation
+ * per instance, and make its results visible.
+ *
+ */
+inline void dispatch_instance_copy(ShaderProgram& program, std::uint32_t count,
+                                   std::uint32_t workgroup_size) {
+    program.dispatch((count + workgroup_size - 1) / workgroup_size, 1, 1);
+
+    // the results are consumed as draw parameters and vertex attributes, and
+    // the commands are rewritten with glBufferSubData by the next pass
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT |
+                    GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+                    GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+}  // namespace detail
+
+inline FrustumCuller::FrustumCuller() noexcept
+    : program_{"frustum_culler",
+               {Shader{ShaderType::Compute, std::string{cull_source}}}} {}
+
+inline auto FrustumCuller::extract_planes(
+    std::span<const float, 16> view_projection) noexcept
+    -> std::array<float, 24> {
+    auto const row = [&](std::size_t r, std::size_t c) {
+        return view_projection[c * 4 + r];
+    };
+
+    std::array<float, 24> planes{};
+    for (std::size_t i = 0; i < 6; ++i) {
+        // left/right, bottom/top and near/far are the sum and difference of
+        // the last row with the first, second and third rows respectively
+        float const sign = (i % 2 == 0) ? 1.0F : -1.0F;
+        std::size_t const axis = i / 2;
+
+        float length_sq{};
+        for (std::size_t c = 0; c < 4; ++c) {
+            planes[i * 4 + c] = row(3, c) + sign * row(axis, c);
+            if (c < 3) {
+                length_sq += planes[i * 4 + c] * planes[i * 4 + c];
+            }
+        }
+
+        float const length = std::sqrt(length_sq);
+        if (length > 0.0F) {
+            for (std::size_t c = 0; c < 4; ++c) {
+                planes[i * 4 + c] /= length;
+            }
+        }
+    }
+
+    return planes;
+}
+
+inline void FrustumCuller::cull(const VertexBufferInst& instances,
+                                const ShaderStorageBuffer& spheres,
+                                std::span<const float, 24> planes,
+                                VertexBufferInst& visible,
+                                IndirectBuffer& commands,
+                                DrawElementsIndirectCommand command,
+                                std::uint32_t command_index) {
+#ifdef RGL_DEBUG
+    if (instances.instance_size() != visible.instance_size() ||
+        spheres.size() < instances.instance_count() * 4 * sizeof(float)) {
+        std::fprintf(stderr,
+                     RGL_LINEINFO
+                     ", mismatched instance layouts or missing bounding "
+                     "spheres\n");
+    }
+#endif  // RGL_DEBUG
+
+    auto const count = static_cast<std::uint32_t>(instances.instance_count());
+
+    visible.reserve(command.base_instance + count);
+
+    command.instance_count = 0;
+    commands.reserve(command_index + 1);
+    commands.bind();
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER,
+                    static_cast<ptrdiff_t>(command_index * sizeof(command)),
+                    sizeof(command), &command);
+
+    if (detail::begin_instance_copy(program_, instances, spheres, planes,
+                                    visible, commands, command.base_instance,
+                                    command_index)) {
+        detail::dispatch_instance_copy(program_, count, workgroup_size);
+    }
+}
+
+}  // namespace rgl
\ No newline at end of file
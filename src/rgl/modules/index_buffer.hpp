@@ -1,12 +1,41 @@
 #pragma once
 
+#include "buffer_arena.hpp"
 #include "gl_functions.hpp"
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <span>
+#include <vector>
 
 namespace rgl {
 
+/**
+ * @brief Enum that specifies the type of the indices of an index buffer.
+ *
+ */
+enum IndexType : std::uint32_t {
+    UNSIGNED_BYTE = GL_UNSIGNED_BYTE,
+    UNSIGNED_SHORT = GL_UNSIGNED_SHORT,
+    UNSIGNED_INT = GL_UNSIGNED_INT
+};
+
+/**
+ * @brief Get the size of an index of the given type, in bytes.
+ *
+ */
+[[nodiscard]] constexpr auto index_type_size(IndexType type) noexcept
+    -> std::size_t {
+    switch (type) {
+        case UNSIGNED_BYTE: return sizeof(std::uint8_t);
+        case UNSIGNED_SHORT: return sizeof(std::uint16_t);
+        case UNSIGNED_INT: return sizeof(std::uint32_t);
+    }
+
+    return sizeof(std::uint32_t);
+}
+
 /**
  * @brief Element Buffer Object (EBO) wrapper.
  *
@@ -17,6 +46,16 @@ namespace rgl {
  * EBOs are used to reduce the amount of data that needs to be sent to the GPU,
  * by allowing the reuse of vertices.
  *
+ * Indices can be 8, 16 or 32 bits wide, 32 bit indices are narrowed to 16
+ * bits when every index is less than 65535, halving the memory and bandwidth
+ * of smaller meshes. 65535 itself is kept wide, as it is the fixed primitive
+ * restart index of 16 bit indices. The type of the indices, given by type(),
+ * must be used by the draw calls.
+ *
+ * An index buffer can also be a view into a rgl::BufferArena, in which case it
+ * does not own a buffer object but a range of the arena, given back on
+ * destruction.
+ *
  * @see vertex_array
  * @see vertex_buffer
  * @see
@@ -30,12 +69,73 @@ public:
     /**
      * @brief Construct a new index buffer object
      *
+     * @note The indices are stored as 16 bit integers if the largest one
+     * fits.
+     *
      * @param indices a pointer to the indices array, can be any contiguous
      * container of std::uint32_t.
      * @param count the number of indices in the array.
      */
     IndexBuffer(std::span<const std::uint32_t> indices) noexcept;
 
+    /**
+     * @brief Construct a new index buffer object from 16 bit indices.
+     *
+     * @param indices the indices.
+     */
+    IndexBuffer(std::span<const std::uint16_t> indices) noexcept;
+
+    /**
+     * @brief Construct a new index buffer object from 8 bit indices.
+     *
+     * @note Some hardware does not support 8 bit indices natively, the driver
+     * then converts them, prefer them for memory bound cases only.
+     *
+     * @param indices the indices.
+     */
+    IndexBuffer(std::span<const std::uint8_t> indices) noexcept;
+
+    /**
+     * @brief Construct a new index buffer object with uninitialized storage,
+     * for indices written by the GPU.
+     *
+     * @param count the number of indices the buffer can hold.
+     * @param type the type of the indices.
+     */
+    IndexBuffer(std::size_t count, IndexType type) noexcept;
+
+    /**
+     * @brief Construct a new index buffer object as a view into an arena.
+     *
+     * @note If the arena is full, the index buffer is left with an id of 0.
+     * The indices of a view keep their type, so that every view of an arena
+     * can share a type and be drawn by a single indirect draw.
+     *
+     * @param arena the arena to allocate from, must outlive the view.
+     * @param indices the indices, copied into the arena.
+     * @see rgl::BufferArena
+     */
+    IndexBuffer(BufferArena& arena,
+                std::span<const std::uint32_t> indices) noexcept;
+
+    /**
+     * @brief Construct a new index buffer object as a view into an arena,
+     * from 16 bit indices.
+     *
+     * @see IndexBuffer(BufferArena&, std::span<const std::uint32_t>)
+     */
+    IndexBuffer(BufferArena& arena,
+                std::span<const std::uint16_t> indices) noexcept;
+
+    /**
+     * @brief Construct a new index buffer object as a view into an arena,
+     * from 8 bit indices.
+     *
+     * @see IndexBuffer(BufferArena&, std::span<const std::uint32_t>)
+     */
+    IndexBuffer(BufferArena& arena,
+                std::span<const std::uint8_t> indices) noexcept;
+
     /**
      * @brief Destroy the index buffer object
      *
@@ -77,6 +177,34 @@ public:
      */
     void unbind() const;
 
+    /**
+     * @brief Give new indices to the index buffer object, overwriting the old
+     * ones.
+     *
+     * @note The buffer keeps its id so vertex arrays referencing it stay
+     * valid, no binding is modified. A view
+     * is moved to another range of its arena if the new indices do not fit in
+     * its current one. The indices are narrowed to 16 bits if the largest one
+     * is less than 65535, unless the index buffer object is a view.
+     *
+     * @param indices the new indices.
+     */
+    void set_data(std::span<const std::uint32_t> indices) noexcept;
+
+    /**
+     * @brief Give new 16 bit indices to the index buffer object.
+     *
+     * @see set_data(std::span<const std::uint32_t>)
+     */
+    void set_data(std::span<const std::uint16_t> indices) noexcept;
+
+    /**
+     * @brief Give new 8 bit indices to the index buffer object.
+     *
+     * @see set_data(std::span<const std::uint32_t>)
+     */
+    void set_data(std::span<const std::uint8_t> indices) noexcept;
+
     /**
      * @brief Get the number of indices in the index buffer object.
      *
@@ -91,45 +219,173 @@ public:
      */
     [[nodiscard]] constexpr auto id() const -> std::uint32_t;
 
+    /**
+     * @brief Get the type of the indices, to pass to the draw calls.
+     *
+     */
+    [[nodiscard]] constexpr auto type() const noexcept -> IndexType {
+        return type_;
+    }
+
+    /**
+     * @brief Check whether the index buffer object is a view into an arena.
+     *
+     */
+    [[nodiscard]] constexpr auto is_view() const noexcept -> bool {
+        return arena_ != nullptr;
+    }
+
+    /**
+     * @brief Get the offset of the indices in the buffer object, in bytes,
+     * always 0 unless the index buffer object is a view.
+     *
+     */
+    [[nodiscard]] constexpr auto offset() const noexcept -> std::size_t {
+        return range_.offset;
+    }
+
+    /**
+     * @brief Get the position of the first index in the buffer object, as
+     * expected by indirect draw commands.
+     *
+     */
+    [[nodiscard]] constexpr auto first_index() const noexcept
+        -> std::uint32_t {
+        return static_cast<std::uint32_t>(range_.offset /
+                                          index_type_size(type_));
+    }
+
+private:
+    /**
+     * @brief Store indices of the given type, in the buffer object or in the
+     * range of the arena.
+     *
+     */
+    void write(std::span<const std::byte> indices, IndexType type) noexcept;
+
+    /**
+     * @brief Create the buffer object, or allocate the range of a view, and
+     * store the first indices.
+     *
+     */
+    template <typename T>
+    void create(std::span<const T> indices) noexcept;
+
+    /**
+     * @brief Delete the buffer object, or give the range back to the arena
+     * for views.
+     *
+     */
+    void release() noexcept;
+
 private:
     std::uint32_t id_{};
     std::int32_t count_{};
+    IndexType type_{UNSIGNED_INT};
+
+    BufferArena* arena_{};
+    ArenaRange range_{};
 };
 
-inline IndexBuffer::IndexBuffer(std::span<const std::uint32_t> indices) noexcept
-    : count_{static_cast<int32_t>(indices.size())} {
-    glGenBuffers(1, &id_);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id_);
+inline IndexBuffer::IndexBuffer(
+    std::span<const std::uint32_t> indices) noexcept {
+    create(indices);
+}
 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 static_cast<ptrdiff_t>(indices.size_bytes()), indices.data(),
-                 GL_STATIC_DRAW);
+inline IndexBuffer::IndexBuffer(
+    std::span<const std::uint16_t> indices) noexcept {
+    create(indices);
 }
 
-inline IndexBuffer::~IndexBuffer() {
-    if (id_ != 0) {
-        glDeleteBuffers(1, &id_);
+inline IndexBuffer::IndexBuffer(
+    std::span<const std::uint8_t> indices) noexcept {
+    create(indices);
+}
+
+inline IndexBuffer::IndexBuffer(std::size_t count, IndexType type) noexcept
+    : count_{static_cast<int32_t>(count)},
+      type_{type} {
+    glCreateBuffers(1, &id_);
+    glNamedBufferData(id_,
+                      static_cast<ptrdiff_t>(count * index_type_size(type)),
+                      nullptr, GL_DYNAMIC_COPY);
+}
+
+inline IndexBuffer::IndexBuffer(BufferArena& arena,
+                                std::span<const std::uint32_t> indices) noexcept
+    : arena_{&arena} {
+    create(indices);
+}
+
+inline IndexBuffer::IndexBuffer(BufferArena& arena,
+                                std::span<const std::uint16_t> indices) noexcept
+    : arena_{&arena} {
+    create(indices);
+}
+
+inline IndexBuffer::IndexBuffer(BufferArena& arena,
+                                std::span<const std::uint8_t> indices) noexcept
+    : arena_{&arena} {
+    create(indices);
+}
+
+template <typename T>
+void IndexBuffer::create(std::span<const T> indices) noexcept {
+    if (arena_ == nullptr) {
+        // the element buffer binding is part of the vertex array state,
+        // direct state access avoids modifying the currently bound vertex
+        // array
+        glCreateBuffers(1, &id_);
+        set_data(indices);
+        return;
+    }
+
+    id_ = arena_->id();
+    set_data(indices);
+
+    if (count_ == 0 && !indices.empty()) [[unlikely]] {
+        id_ = 0;
+        arena_ = nullptr;
     }
 }
 
+inline IndexBuffer::~IndexBuffer() { release(); }
+
 inline IndexBuffer::IndexBuffer(IndexBuffer&& other) noexcept
     : id_{other.id_},
-      count_{other.count_} {
+      count_{other.count_},
+      type_{other.type_},
+      arena_{other.arena_},
+      range_{other.range_} {
     other.id_ = 0;
+    other.arena_ = nullptr;
 }
 
 inline auto IndexBuffer::operator=(IndexBuffer&& other) noexcept
     -> IndexBuffer& {
     if (this != &other) {
+        release();
         id_ = other.id_;
         count_ = other.count_;
+        type_ = other.type_;
+        arena_ = other.arena_;
+        range_ = other.range_;
 
         other.id_ = 0;
+        other.arena_ = nullptr;
     }
 
     return *this;
 }
 
+inline void IndexBuffer::release() noexcept {
+    if (arena_ != nullptr) {
+        arena_->deallocate(range_);
+    } else if (id_ != 0) {
+        glDeleteBuffers(1, &id_);
+    }
+}
+
 inline void IndexBuffer::bind() const {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id_);
 }
@@ -138,6 +394,64 @@ inline void IndexBuffer::unbind() const {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
+inline void IndexBuffer::set_data(
+    std::span<const std::uint32_t> indices) noexcept {
+    // views keep the type they are given, see the arena constructors, and
+    // 0xFFFF would be taken for GL_PRIMITIVE_RESTART_FIXED_INDEX
+    bool const narrow =
+        arena_ == nullptr && !indices.empty() &&
+        *std::max_element(indices.begin(), indices.end()) < UINT16_MAX;
+
+    if (narrow) {
+        std::vector<std::uint16_t> const narrowed(indices.begin(),
+                                                  indices.end());
+        write(std::as_bytes(std::span{narrowed}), UNSIGNED_SHORT);
+        return;
+    }
+
+    write(std::as_bytes(indices), UNSIGNED_INT);
+}
+
+inline void IndexBuffer::set_data(
+    std::span<const std::uint16_t> indices) noexcept {
+    write(std::as_bytes(indices), UNSIGNED_SHORT);
+}
+
+inline void IndexBuffer::set_data(
+    std::span<const std::uint8_t> indices) noexcept {
+    write(std::as_bytes(indices), UNSIGNED_BYTE);
+}
+
+inline void IndexBuffer::write(std::span<const std::byte> indices,
+                               IndexType type) noexcept {
+    std::size_t const size = index_type_size(type);
+    count_ = static_cast<int32_t>(indices.size() / size);
+    type_ = type;
+
+    if (arena_ != nullptr) {
+        // a range aligned for smaller indices may not be for larger ones
+        if (indices.size() > range_.size || range_.offset % size != 0) {
+            arena_->deallocate(range_);
+            auto const range = arena_->allocate(indices.size(), size);
+
+            if (!range.has_value()) [[unlikely]] {
+                count_ = 0;
+                range_ = {};
+                return;
+            }
+            range_ = range.value();
+        }
+
+        arena_->write(range_.offset, indices);
+        return;
+    }
+
+    glNamedBufferData(id_, static_cast<ptrdiff_t>(indices.size()),
+                      indices.data(), GL_STATIC_DRAW);
+}
+
 constexpr auto IndexBuffer::count() const -> std::int32_t { return count_; }
 
+constexpr auto IndexBuffer::id() const -> std::uint32_t { return id_; }
+
 }  // namespace rgl
\ No newline at end of file
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "gl_functions.hpp"
+#include "vertex_buffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace rgl {
+
+/**
+ * @brief A single indexed indirect draw, as consumed by
+ * glMultiDrawElementsIndirect.
+ *
+ * @details The layout is mandated by the OpenGL specification and must not be
+ * changed, it is the same one the GPU reads from the indirect buffer, which
+ * also means compute shaders can write these commands directly.
+ *
+ * @see
+ * https://www.khronos.org/opengl/wiki/Vertex_Rendering#Indirect_rendering
+ */
+struct DrawElementsIndirectCommand {
+    std::uint32_t count{};
+    std::uint32_t instance_count{};
+    std::uint32_t first_index{};
+    std::int32_t base_vertex{};
+    std::uint32_t base_instance{};
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 5 * sizeof(std::uint32_t),
+              "DrawElementsIndirectCommand must be tightly packed");
+
+/**
+ * @brief Draw indirect buffer wrapper.
+ *
+ * @details Stores an array of indirect draw commands in GPU memory, to be
+ * bound to GL_DRAW_INDIRECT_BUFFER and consumed by indirect draw calls. The
+ * buffer grows when it is given more commands than it can hold.
+ *
+ * @see rgl::DrawElementsIndirectCommand
+ */
+class IndirectBuffer {
+public:
+    IndirectBuffer() noexcept;
+
+    /**
+     * @brief Construct a new indirect buffer object
+     *
+     * @param commands the initial commands, can be empty.
+     * @param hint the usage hint of the buffer, defaults to DYNAMIC_DRAW as the
+     * commands are usually rewritten every frame.
+     */
+    IndirectBuffer(
+        std::span<const DrawElementsIndirectCommand> commands,
+        DriverDrawHint hint = DriverDrawHint::DYNAMIC_DRAW) noexcept;
+
+    ~IndirectBuffer();
+
+    IndirectBuffer(const IndirectBuffer&) = delete;
+    auto operator=(const IndirectBuffer&) -> IndirectBuffer& = delete;
+
+    IndirectBuffer(IndirectBuffer&& other) noexcept;
+    auto operator=(IndirectBuffer&& other) noexcept -> IndirectBuffer&;
+
+    /**
+     * @brief Bind the indirect buffer object to GL_DRAW_INDIRECT_BUFFER.
+     *
+     */
+    void bind() const;
+
+    /**
+     * @brief Unbind any indirect buffer object.
+     *
+     */
+    static void unbind();
+
+    /**
+     * @brief Replace the commands of the buffer.
+     *
+     * @details The storage is only reallocated if the commands do not fit in
+     * the current capacity.
+     *
+     * @note Binds the buffer to GL_DRAW_INDIRECT_BUFFER.
+     *
+     * @param commands the new commands.
+     */
+    void set_data(std::span<const DrawElementsIndirectCommand> commands);
+
+    /**
+     * @brief Make sure the buffer can hold a number of commands, without
+     * preserving its contents.
+     *
+     * @details Useful when the commands are written by the GPU.
+     *
+     * @note Binds the buffer to GL_DRAW_INDIRECT_BUFFER.
+     *
+     * @param count the number of commands.
+     */
+    void reserve(std::size_t count);
+
+    // UTILITIES
+
+    [[nodiscard]] constexpr auto id() const noexcept -> std::uint32_t {
+        return id_;
+    }
+
+    /**
+     * @brief Get the number of commands last given to set_data().
+     *
+     */
+    [[nodiscard]] constexpr auto count() const noexcept -> std::size_t {
+        return count_;
+    }
+
+    /**
+     * @brief Get the number of commands the buffer can hold.
+     *
+     */
+    [[nodiscard]] constexpr auto capacity() const noexcept -> std::size_t {
+        return capacity_;
+    }
+
+private:
+    std::uint32_t id_{};
+    DriverDrawHint hint_{DriverDrawHint::DYNAMIC_DRAW};
+    std::size_t count_{};
+    std::size_t capacity_{};
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+inline IndirectBuffer::IndirectBuffer() noexcept
+    : IndirectBuffer{std::span<const DrawElementsIndirectCommand>{}} {}
+
+inline IndirectBuffer::IndirectBuffer(
+    std::span<const DrawElementsIndirectCommand> commands,
+    DriverDrawHint hint) noexcept
+    : hint_{hint},
+      count_{commands.size()},
+      capacity_{commands.size()} {
+    glGenBuffers(1, &id_);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, id_);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                 static_cast<ptrdiff_t>(commands.size_bytes()),
+                 commands.data(), hint_);
+}
+
+inline IndirectBuffer::~IndirectBuffer() {
+    if (id_ != 0) {
+        glDeleteBuffers(1, &id_);
+    }
+}
+
+inline IndirectBuffer::IndirectBuffer(IndirectBuffer&& other) noexcept
+    : id_{other.id_},
+      hint_{other.hint_},
+      count_{other.count_},
+      capacity_{other.capacity_} {
+    other.id_ = 0;
+}
+
+inline auto IndirectBuffer::operator=(IndirectBuffer&& other) noexcept
+    -> IndirectBuffer& {
+    if (this != &other) {
+        glDeleteBuffers(1, &id_);
+        id_ = other.id_;
+        hint_ = other.hint_;
+        count_ = other.count_;
+        capacity_ = other.capacity_;
+
+        other.id_ = 0;
+    }
+
+    return *this;
+}
+
+inline void IndirectBuffer::bind() const {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, id_);
+}
+
+inline void IndirectBuffer::unbind() {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+inline void IndirectBuffer::set_data(
+    std::span<const DrawElementsIndirectCommand> commands) {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, id_);
+
+    if (commands.size() > capacity_) {
+        glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                     static_cast<ptrdiff_t>(commands.size_bytes()),
+                     commands.data(), hint_);
+        capacity_ = commands.size();
+    } else if (!commands.empty()) {
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0,
+                        static_cast<ptrdiff_t>(commands.size_bytes()),
+                        commands.data());
+    }
+
+    count_ = commands.size();
+}
+
+inline void IndirectBuffer::reserve(std::size_t count) {
+    if (count <= capacity_) {
+        return;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, id_);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                 static_cast<ptrdiff_t>(count *
+                                        sizeof(DrawElementsIndirectCommand)),
+                 nullptr, hint_);
+    capacity_ = count;
+}
+
+}  // namespace rgl
\ No newline at end of file
@@ -0,0 +1,691 @@
+#pragma once
+
+#include "frustum_culler.hpp"
+#include "gl_functions.hpp"
+#include "indirect_buffer.hpp"
+#include "mesh_optimization.hpp"
+#include "shader.hpp"
+#include "shader_storage_buffer.hpp"
+#include "vertex_buffer_inst.hpp"
+#include "vertex_buffer_layout.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace rgl {
+
+/**
+ * @brief Result of the simplification of a mesh.
+ *
+ */
+struct SimplifiedMesh {
+    std::vector<std::uint32_t> indices;
+    float error{};  // largest distance to the original surface, model units
+};
+
+/**
+ * @brief A level of detail of a mesh, a range of the indices of a LodChain.
+ *
+ */
+struct LodLevel {
+    std::uint32_t first_index{};
+    std::uint32_t index_count{};
+    float error{};  // distance to the full detail surface, model units
+};
+
+/**
+ * @brief Levels of detail of a mesh, from the most to the least detailed.
+ *
+ * @details The indices of every level are stored one after the other and
+ * refer to the same vertices, so the whole chain fits in a single index buffer
+ * drawn with a single vertex buffer, each level being an indirect draw
+ * command.
+ *
+ */
+struct LodChain {
+    std::vector<std::uint32_t> indices;
+    std::vector<LodLevel> levels;
+};
+
+/**
+ * @brief Simplify a triangle list, without moving or adding vertices.
+ *
+ * @details Collapses edges in order of their quadric error (Garland and
+ * Heckbert, 1997), one vertex into the other, so that the simplified indices
+ * keep referring to the original vertex buffer. Vertices on the border of the
+ * mesh and vertices sharing their position with others, such as the ones of
+ * uv seams, are never moved, and collapses that would flip or fold a
+ * triangle are rejected.
+ *
+ * The planes of the quadrics are weighted by the area of their triangles, and
+ * the error of a collapse is divided by the total weight, so that it is a
+ * squared distance whatever the size of the triangles.
+ *
+ * @param indices the indices of the triangle list.
+ * @param vertices the float vertices the indices refer to.
+ * @param layout the layout of the vertices.
+ * @param target_index_count the number of indices to stop at, the result can
+ * be larger if the mesh cannot be simplified further.
+ * @param max_error the largest distance to the original surface allowed, in
+ * model units.
+ * @param position_attribute the index of the vec3 position attribute.
+ * @return SimplifiedMesh the simplified indices and their error.
+ */
+[[nodiscard]] auto simplify(
+    std::span<const std::uint32_t> indices, std::span<const float> vertices,
+    const VertexBufferLayout& layout, std::size_t target_index_count,
+    float max_error = std::numeric_limits<float>::max(),
+    std::size_t position_attribute = 0) -> SimplifiedMesh;
+
+/**
+ * @brief Generate the levels of detail of a mesh by repeated simplification.
+ *
+ * @details The first level is the mesh itself. The generation stops early
+ * once a simplification removes less than a tenth of the triangles.
+ *
+ * @param indices the indices of the triangle list.
+ * @param vertices the float vertices the indices refer to.
+ * @param layout the layout of the vertices.
+ * @param max_levels the maximum number of levels, including the first one,
+ * at most LodSelector::max_levels.
+ * @param reduction the ratio of triangles kept from a level to the next.
+ * @param position_attribute the index of the vec3 position attribute.
+ * @return LodChain the levels of detail.
+ */
+[[nodiscard]] auto build_lod_chain(std::span<const std::uint32_t> indices,
+                                   std::span<const float> vertices,
+                                   const VertexBufferLayout& layout,
+                                   std::size_t max_levels = 4,
+                                   float reduction = 0.5F,
+                                   std::size_t position_attribute = 0)
+    -> LodChain;
+
+/**
+ * @brief GPU-driven level of detail selection of instances.
+ *
+ * @details Runs a compute pass which picks, for every instance, the least
+ * detailed level whose error, projected on the screen, stays under a
+ * threshold in pixels. Each level has its own indirect draw command and its
+ * own range of a second instance buffer, the instances are copied into the
+ * range of their level and counted in its command, so that every level is
+ * drawn by a single VertexArray::draw_indirect() without CPU readback.
+ *
+ * The instances are also culled against the view frustum, like
+ * FrustumCuller does, their bounding spheres living in a shader storage
+ * buffer, one `vec4` per instance.
+ *
+ * Typical usage, once per frame:
+ *
+ * @code
+ * selector.select(instances, spheres, FrustumCuller::extract_planes(view_proj),
+ *                 camera, LodSelector::projection_scale(fov_y, height), 1.0F,
+ *                 chain.levels, vao.instanced_data().value(), commands,
+ *                 mesh_command);
+ * vao.draw_indirect(commands, 0, chain.levels.size());
+ * @endcode
+ *
+ * @note The errors of the levels are in the units of the bounding spheres, an
+ * instance scaled by a factor should have errors scaled by the same factor.
+ *
+ * @see build_lod_chain
+ * @see rgl::FrustumCuller
+ */
+class LodSelector {
+public:
+    /**
+     * @brief Number of instances processed by a single work group.
+     *
+     */
+    static constexpr std::uint32_t workgroup_size = 64;
+
+    /**
+     * @brief Maximum number of levels of detail of a mesh.
+     *
+     */
+    static constexpr std::size_t max_levels = 8;
+
+    /**
+     * @brief Construct a new lod selector object, compiling its compute
+     * shader.
+     *
+     */
+    LodSelector() noexcept;
+
+    LodSelector(const LodSelector&) = delete;
+    auto operator=(const LodSelector&) -> LodSelector& = delete;
+
+    LodSelector(LodSelector&&) noexcept = default;
+    auto operator=(LodSelector&&) noexcept -> LodSelector& = default;
+
+    ~LodSelector() = default;
+
+    /**
+     * @brief Compute the number of pixels an object of size 1 at a distance
+     * of 1 covers on the screen.
+     *
+     * @param fov_y the vertical field of view, in radians.
+     * @param viewport_height the height of the viewport, in pixels.
+     * @return float the projection scale.
+     */
+    [[nodiscard]] static auto projection_scale(float fov_y,
+                                               float viewport_height) noexcept
+        -> float {
+        return viewport_height / (2.0F * std::tan(fov_y * 0.5F));
+    }
+
+    /**
+     * @brief Select the level of detail of every instance of an instance
+     * buffer.
+     *
+     * @details Writes one command per level into `commands`, starting at
+     * `command_index`, from `command` and the range of the level, with their
+     * instance count reset to zero. The instances of level `i` are copied into
+     * `routed` starting at instance `command.base_instance + i *
+     * instances.instance_count()`.
+     *
+     * @note Deferred instance buffers must be flushed before the selection.
+     * The routed buffer is grown if needed, it must use the buffered storage
+     * as its contents are written by the GPU, and must not be edited through
+     * the instance API, which would overwrite them.
+     *
+     * @warning The indirect buffer is reallocated, losing its contents, if it
+     * cannot hold the commands, reserve it beforehand when it holds others.
+     *
+     * @param instances the instances to route.
+     * @param spheres the bounding spheres of the instances.
+     * @param planes the frustum planes, see FrustumCuller::extract_planes().
+     * @param camera the position of the camera.
+     * @param projection_scale see projection_scale().
+     * @param threshold the largest error allowed on screen, in pixels.
+     * @param levels the levels of detail, from the most detailed.
+     * @param routed the instance buffer receiving the routed instances, with
+     * the same layout as `instances`.
+     * @param commands the indirect buffer receiving the draw commands.
+     * @param command the draw command of the whole index buffer holding the
+     * chain, giving the first index, base vertex and base instance.
+     * @param command_index the index of the first command in `commands`.
+     */
+    void select(const VertexBufferInst& instances,
+                const ShaderStorageBuffer& spheres,
+                std::span<const float, 24> planes,
+                std::span<const float, 3> camera, float projection_scale,
+                float threshold, std::span<const LodLevel> levels,
+                VertexBufferInst& routed, IndirectBuffer& commands,
+                DrawElementsIndirectCommand command,
+                std::uint32_t command_index = 0);
+
+    // UTILITIES
+
+    [[nodiscard]] auto program() noexcept -> ShaderProgram& {
+        return program_;
+    }
+
+private:
+    static constexpr std::string_view select_source{R"(#version 460 core
+layout(local_size_x = 64) in;
+
+// instances are copied as raw words, see FrustumCuller
+layout(std430, binding = 0) readonly buffer Instances { uint src[]; };
+layout(std430, binding = 1) readonly buffer Spheres { vec4 spheres[]; };
+layout(std430, binding = 2) writeonly buffer Routed { uint dst[]; };
+layout(std430, binding = 3) buffer Commands { uint commands[]; };
+
+uniform vec4 u_planes[6];
+uniform vec3 u_camera;
+uniform float u_errors[8];
+uniform int u_level_count;
+uniform float u_error_scale;
+uniform int u_instance_count;
+uniform int u_stride;
+uniform int u_src_offset;
+uniform int u_dst_offset;
+uniform int u_command;
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= uint(u_instance_count)) {
+        return;
+    }
+
+    vec4 sphere = spheres[id];
+    for (int i = 0; i < 6; ++i) {
+        if (dot(u_planes[i].xyz, sphere.xyz) + u_planes[i].w < -sphere.w) {
+            return;
+        }
+    }
+
+    // error * projection_scale / distance <= threshold, with the distance to
+    // the closest point of the sphere
+    float distance = max(length(sphere.xyz - u_camera) - sphere.w, 1e-4);
+    int level = 0;
+    for (int i = 1; i < u_level_count; ++i) {
+        if (u_errors[i] * u_error_scale <= distance) {
+            level = i;
+        }
+    }
+
+    // instance_count is the second member of the command
+    uint slot = atomicAdd(commands[(u_command + level) * 5 + 1], 1u);
+
+    uint stride = uint(u_stride);
+    uint from = uint(u_src_offset) + id * stride;
+    uint to = uint(u_dst_offset) +
+              (uint(level * u_instance_count) + slot) * stride;
+    for (uint i = 0u; i < stride; ++i) {
+        dst[to + i] = src[from + i];
+    }
+}
+)"};
+
+    static constexpr std::array<std::string_view, max_levels> error_names{
+        "u_errors[0]", "u_errors[1]", "u_errors[2]", "u_errors[3]",
+        "u_errors[4]", "u_errors[5]", "u_errors[6]", "u_errors[7]"};
+
+    ShaderProgram program_;
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+namespace detail {
+
+/**
+ * @brief Symmetric 4x4 matrix measuring the squared distance of a point to a
+ * set of planes.
+ *
+ */
+struct Quadric {
+    // a², ab, ac, ad, b², bc, bd, c², cd, d²
+    std::array<double, 10> q{};
+    // sum of the weights of the planes
+    double weight{};
+
+    [[nodiscard]] static auto plane(double a, double b, double c, double d,
+                                    double weight) noexcept -> Quadric {
+        return {{a * a * weight, a * b * weight, a * c * weight, a * d * weight,
+                 b * b * weight, b * c * weight, b * d * weight, c * c * weight,
+                 c * d * weight, d * d * weight},
+                weight};
+    }
+
+    void add(const Quadric& other) noexcept {
+        for (std::size_t i = 0; i < q.size(); ++i) {
+            q[i] += other.q[i];
+        }
+        weight += other.weight;
+    }
+
+    /**
+     * @brief Weighted mean of the squared distances of a point to the planes,
+     * which does not depend on the size of the triangles.
+     *
+     */
+    [[nodiscard]] auto error(std::array<float, 3> p) const noexcept
+        -> double {
+        return weight > 0.0 ? std::max(evaluate(p) / weight, 0.0) : 0.0;
+    }
+
+    [[nodiscard]] auto evaluate(std::array<float, 3> p) const noexcept
+        -> double {
+        double const x = p[0];
+        double const y = p[1];
+        double const z = p[2];
+
+        return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z +
+               2 * q[3] * x + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y +
+               q[7] * z * z + 2 * q[8] * z + q[9];
+    }
+};
+
+/**
+ * @brief Unnormalized normal of a triangle.
+ *
+ */
+[[nodiscard]] inline auto triangle_normal(std::array<float, 3> a,
+                                          std::array<float, 3> b,
+                                          std::array<float, 3> c) noexcept
+    -> std::array<float, 3> {
+    std::array<float, 3> const ab{b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    std::array<float, 3> const ac{c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+
+    return {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2],
+            ab[0] * ac[1] - ab[1] * ac[0]};
+}
+
+}  // namespace detail
+
+inline auto simplify(std::span<const std::uint32_t> indices,
+                     std::span<const float> vertices,
+                     const VertexBufferLayout& layout,
+                     std::size_t target_index_count, float max_error,
+                     std::size_t position_attribute) -> SimplifiedMesh {
+    SimplifiedMesh result{
+        {indices.begin(), indices.begin() + (indices.size() / 3) * 3}, 0.0F};
+
+    std::size_t const stride = layout.stride_elements();
+    if (stride == 0 || result.indices.size() <= target_index_count) {
+        return result;
+    }
+
+    std::size_t const vertex_count = vertices.size() / stride;
+    std::size_t const position =
+        layout[position_attribute].offset / sizeof(float);
+
+    auto const position_of = [&](std::uint32_t vertex) {
+        float const* p = vertices.data() + vertex * stride + position;
+        return std::array<float, 3>{p[0], p[1], p[2]};
+    };
+
+    std::vector<bool> locked(vertex_count, false);
+
+    // vertices sharing a position with others, attribute seams
+    std::vector<std::uint32_t> sorted(vertex_count);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::sort(sorted.begin(), sorted.end(),
+              [&](std::uint32_t lhs, std::uint32_t rhs) {
+                  return position_of(lhs) < position_of(rhs);
+              });
+    for (std::size_t i = 1; i < sorted.size(); ++i) {
+        if (position_of(sorted[i - 1]) == position_of(sorted[i])) {
+            locked[sorted[i - 1]] = true;
+            locked[sorted[i]] = true;
+        }
+    }
+
+    // vertices of edges used by a single triangle, borders
+    std::unordered_map<std::uint64_t, std::uint32_t> edge_uses;
+    auto const edge_key = [](std::uint32_t a, std::uint32_t b) {
+        return (static_cast<std::uint64_t>(std::min(a, b)) << 32) |
+               std::max(a, b);
+    };
+    for (std::size_t i = 0; i < result.indices.size(); i += 3) {
+        for (std::size_t k = 0; k < 3; ++k) {
+            ++edge_uses[edge_key(result.indices[i + k],
+                                 result.indices[i + (k + 1) % 3])];
+        }
+    }
+    for (auto const& [key, uses] : edge_uses) {
+        if (uses == 1) {
+            locked[static_cast<std::uint32_t>(key >> 32)] = true;
+            locked[static_cast<std::uint32_t>(key)] = true;
+        }
+    }
+
+    // area weighted plane quadrics, normalized by their weight when evaluated
+    std::vector<detail::Quadric> quadrics(vertex_count);
+    for (std::size_t i = 0; i < result.indices.size(); i += 3) {
+        auto const a = position_of(result.indices[i]);
+        auto const normal = detail::triangle_normal(
+            a, position_of(result.indices[i + 1]),
+            position_of(result.indices[i + 2]));
+
+        double const length = std::sqrt(double{normal[0]} * normal[0] +
+                                        double{normal[1]} * normal[1] +
+                                        double{normal[2]} * normal[2]);
+        if (length == 0.0) {
+            continue;
+        }
+
+        double const nx = normal[0] / length;
+        double const ny = normal[1] / length;
+        double const nz = normal[2] / length;
+        auto const quadric = detail::Quadric::plane(
+            nx, ny, nz, -(nx * a[0] + ny * a[1] + nz * a[2]), length * 0.5);
+
+        for (std::size_t k = 0; k < 3; ++k) {
+            quadrics[result.indices[i + k]].add(quadric);
+        }
+    }
+
+    struct Collapse {
+        std::uint32_t from;
+        std::uint32_t to;
+        double cost;
+    };
+
+    double const max_cost = static_cast<double>(max_error) * max_error;
+    double worst_cost{0.0};
+    std::vector<Collapse> collapses;
+    std::vector<std::uint32_t> remap(vertex_count);
+    std::vector<bool> touched(vertex_count);
+
+    auto const add_collapse = [&](std::uint32_t from, std::uint32_t to) {
+        if (locked[from]) {
+            return;
+        }
+
+        detail::Quadric quadric = quadrics[from];
+        quadric.add(quadrics[to]);
+        collapses.push_back({from, to, quadric.error(position_of(to))});
+    };
+
+    while (result.indices.size() > target_index_count) {
+        std::size_t const triangle_count = result.indices.size() / 3;
+
+        collapses.clear();
+        for (std::size_t i = 0; i < result.indices.size(); i += 3) {
+            for (std::size_t k = 0; k < 3; ++k) {
+                std::uint32_t const a = result.indices[i + k];
+                std::uint32_t const b = result.indices[i + (k + 1) % 3];
+
+                add_collapse(a, b);
+                add_collapse(b, a);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse& lhs, const Collapse& rhs) {
+                      return lhs.cost < rhs.cost;
+                  });
+
+        optimization::detail::Adjacency const adjacency{result.indices,
+                                                        vertex_count};
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+        std::size_t removed{};
+
+        for (auto const& [from, to, cost] : collapses) {
+            if (cost > max_cost ||
+                (triangle_count - removed) * 3 <= target_index_count) {
+                break;
+            }
+            if (touched[from] || touched[to]) {
+                continue;
+            }
+
+            // reject collapses flipping the triangles that are not removed
+            bool flips{false};
+            std::size_t degenerate{};
+            for (std::uint32_t const t : adjacency.of(from)) {
+                std::array<std::uint32_t, 3> triangle{
+                    result.indices[t * 3], result.indices[t * 3 + 1],
+                    result.indices[t * 3 + 2]};
+
+                if (std::find(triangle.begin(), triangle.end(), to) !=
+                    triangle.end()) {
+                    ++degenerate;
+                    continue;
+                }
+
+                auto const before =
+                    detail::triangle_normal(position_of(triangle[0]),
+                                            position_of(triangle[1]),
+                                            position_of(triangle[2]));
+                std::replace(triangle.begin(), triangle.end(), from, to);
+                auto const after =
+                    detail::triangle_normal(position_of(triangle[0]),
+                                            position_of(triangle[1]),
+                                            position_of(triangle[2]));
+
+                // turning by more than about 75 degrees counts as a flip, to
+                // also reject the slivers folding over their neighbours
+                float const dot = before[0] * after[0] +
+                                  before[1] * after[1] + before[2] * after[2];
+                float const lengths_sq =
+                    (before[0] * before[0] + before[1] * before[1] +
+                     before[2] * before[2]) *
+                    (after[0] * after[0] + after[1] * after[1] +
+                     after[2] * after[2]);
+                if (dot <= 0.0F || dot * dot < 0.0625F * lengths_sq) {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips) {
+                continue;
+            }
+
+            // the triangles around the collapse changed, their vertices wait
+            // for the next pass
+            for (std::uint32_t const t : adjacency.of(from)) {
+                for (std::size_t k = 0; k < 3; ++k) {
+                    touched[result.indices[t * 3 + k]] = true;
+                }
+            }
+            touched[to] = true;
+
+            remap[from] = to;
+            quadrics[to].add(quadrics[from]);
+            worst_cost = std::max(worst_cost, cost);
+            removed += degenerate;
+        }
+
+        if (removed == 0) {
+            break;
+        }
+
+        std::size_t write{};
+        for (std::size_t i = 0; i < result.indices.size(); i += 3) {
+            std::uint32_t const a = remap[result.indices[i]];
+            std::uint32_t const b = remap[result.indices[i + 1]];
+            std::uint32_t const c = remap[result.indices[i + 2]];
+
+            if (a != b && b != c && a != c) {
+                result.indices[write++] = a;
+                result.indices[write++] = b;
+                result.indices[write++] = c;
+            }
+        }
+        result.indices.resize(write);
+    }
+
+    result.error = static_cast<float>(std::sqrt(worst_cost));
+    return result;
+}
+
+inline auto build_lod_chain(std::span<const std::uint32_t> indices,
+                            std::span<const float> vertices,
+                            const VertexBufferLayout& layout,
+                            std::size_t max_levels, float reduction,
+                            std::size_t position_attribute) -> LodChain {
+    max_levels =
+        std::clamp<std::size_t>(max_levels, 1, LodSelector::max_levels);
+
+    LodChain chain;
+    chain.indices.assign(indices.begin(),
+                         indices.begin() + (indices.size() / 3) * 3);
+    chain.levels.push_back(
+        {0, static_cast<std::uint32_t>(chain.indices.size()), 0.0F});
+
+    while (chain.levels.size() < max_levels) {
+        LodLevel const previous = chain.levels.back();
+        auto const source = std::span{chain.indices}.subspan(
+            previous.first_index, previous.index_count);
+
+        auto const target = static_cast<std::size_t>(
+            static_cast<float>(source.size() / 3) * reduction) * 3;
+        auto simplified = simplify(source, vertices, layout, target,
+                                   std::numeric_limits<float>::max(),
+                                   position_attribute);
+
+        if (simplified.indices.size() * 10 > source.size() * 9) {
+            break;
+        }
+
+        // each level is simplified from the previous one, their errors add up
+        chain.levels.push_back(
+            {static_cast<std::uint32_t>(chain.indices.size()),
+             static_cast<std::uint32_t>(simplified.indices.size()),
+             previous.error + simplified.error});
+        chain.indices.insert(chain.indices.end(), simplified.indices.begin(),
+                             simplified.indices.end());
+    }
+
+    return chain;
+}
+
+inline LodSelector::LodSelector() noexcept
+    : program_{"lod_selector",
+               {Shader{ShaderType::Compute, std::string{select_source}}}} {}
+
+inline void LodSelector::select(const VertexBufferInst& instances,
+                                const ShaderStorageBuffer& spheres,
+                                std::span<const float, 24> planes,
+                                std::span<const float, 3> camera,
+                                float projection_scale, float threshold,
+                                std::span<const LodLevel> levels,
+                                VertexBufferInst& routed,
+                                IndirectBuffer& commands,
+                                DrawElementsIndirectCommand command,
+                                std::uint32_t command_index) {
+#ifdef RGL_DEBUG
+    if (instances.instance_size() != routed.instance_size() ||
+        spheres.size() < instances.instance_count() * 4 * sizeof(float) ||
+        levels.empty() || levels.size() > max_levels) {
+        std::fprintf(stderr,
+                     RGL_LINEINFO
+                     ", mismatched instance layouts, missing bounding spheres "
+                     "or invalid level count\n");
+    }
+#endif  // RGL_DEBUG
+
+    levels = levels.first(std::min(levels.size(), max_levels));
+    auto const count = static_cast<std::uint32_t>(instances.instance_count());
+
+    routed.reserve(command.base_instance + levels.size() * count);
+
+    std::array<DrawElementsIndirectCommand, max_levels> level_commands{};
+    for (std::size_t i = 0; i < levels.size(); ++i) {
+        level_commands[i] = {
+            levels[i].index_count, 0,
+            command.first_index + levels[i].first_index, command.base_vertex,
+            command.base_instance + static_cast<std::uint32_t>(i) * count};
+    }
+
+    commands.reserve(command_index + levels.size());
+    commands.bind();
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER,
+                    static_cast<ptrdiff_t>(command_index * sizeof(command)),
+                    static_cast<ptrdiff_t>(levels.size() * sizeof(command)),
+                    level_commands.data());
+
+    if (levels.empty() ||
+        !detail::begin_instance_copy(program_, instances, spheres, planes,
+                                     routed, commands, command.base_instance,
+                                     command_index)) {
+        return;
+    }
+
+    for (std::size_t i = 0; i < levels.size(); ++i) {
+        program_.set_uniform1f(error_names[i], levels[i].error);
+    }
+    program_.set_uniform3f("u_camera", camera[0], camera[1], camera[2]);
+    program_.set_uniform1i("u_level_count", static_cast<int>(levels.size()));
+    program_.set_uniform1f("u_error_scale", projection_scale / threshold);
+
+    detail::dispatch_instance_copy(program_, count, workgroup_size);
+}
+
+}  // namespace rgl
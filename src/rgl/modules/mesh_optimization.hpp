@@ -0,0 +1,495 @@
+#pragma once
+
+#include "vertex_buffer_layout.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <vector>
+
+namespace rgl::optimization {
+
+/**
+ * @brief Default size of the simulated post-transform vertex cache.
+ *
+ * @details Hardware no longer has a fixed size FIFO cache, but vertex reuse
+ * still happens within small batches of primitives, which a FIFO of this size
+ * models well enough on desktop GPUs.
+ */
+inline constexpr std::size_t default_cache_size{16};
+
+/**
+ * @brief Compute the average cache miss ratio (ACMR) of a triangle list, the
+ * number of vertex shader invocations per triangle with a FIFO cache.
+ *
+ * @details Ranges from 3, no reuse at all, down to about 0.5 for a perfectly
+ * ordered regular grid.
+ *
+ * @param indices the indices of the triangle list.
+ * @param vertex_count the number of vertices the indices refer to.
+ * @param cache_size the size of the simulated cache.
+ * @return float the average number of cache misses per triangle.
+ */
+[[nodiscard]] auto analyze_vertex_cache(
+    std::span<const std::uint32_t> indices, std::size_t vertex_count,
+    std::size_t cache_size = default_cache_size) -> float;
+
+/**
+ * @brief Reorder triangles for post-transform vertex cache locality.
+ *
+ * @details Implements Tipsify (Sander, Nehab and Barczak, 2007): triangles are
+ * emitted as fans around a vertex, the next fan being chosen among the
+ * vertices of the current one which will still be in the cache once their
+ * remaining triangles are emitted. It runs in linear time, and gets within a
+ * few percent of the slower Forsyth algorithm on typical meshes.
+ *
+ * @note The winding of the triangles is preserved.
+ *
+ * @param indices the indices of the triangle list, reordered in place.
+ * @param vertex_count the number of vertices the indices refer to.
+ * @param cache_size the size of the targeted cache.
+ */
+void optimize_vertex_cache(std::span<std::uint32_t> indices,
+                           std::size_t vertex_count,
+                           std::size_t cache_size = default_cache_size);
+
+/**
+ * @brief Reorder clusters of triangles to reduce overdraw.
+ *
+ * @details The triangles are split into clusters, at the points where the
+ * vertex cache gets flushed anyway, and where the miss ratio of the current
+ * cluster is within `threshold` of the miss ratio of the whole mesh. The
+ * clusters are then sorted so that the ones facing away from the center of the
+ * mesh, likely in front of the others, are drawn first and occlude them.
+ *
+ * @note Meant to be run after optimize_vertex_cache, whose order is kept
+ * within clusters.
+ *
+ * @param indices the indices of the triangle list, reordered in place.
+ * @param vertices the float vertices the indices refer to.
+ * @param layout the layout of the vertices.
+ * @param position_attribute the index of the vec3 position attribute.
+ * @param threshold how much the miss ratio can degrade, 1.05 allows 5% more
+ * vertex shader invocations in exchange for smaller clusters.
+ * @param cache_size the size of the targeted cache.
+ */
+void optimize_overdraw(std::span<std::uint32_t> indices,
+                       std::span<const float> vertices,
+                       const VertexBufferLayout& layout,
+                       std::size_t position_attribute = 0,
+                       float threshold = 1.05F,
+                       std::size_t cache_size = default_cache_size);
+
+/**
+ * @brief Reorder vertices in the order the indices first reference them, for
+ * vertex fetch locality.
+ *
+ * @details The indices are remapped accordingly, vertices which are never
+ * referenced are moved past the referenced ones.
+ *
+ * @note Meant to be run last, after the triangles are reordered.
+ *
+ * @param indices the indices of the triangle list, remapped in place.
+ * @param vertices the interleaved vertices, reordered in place.
+ * @param stride the size of a vertex in bytes.
+ * @return std::size_t the number of referenced vertices, the ones past it can
+ * be dropped.
+ */
+auto optimize_vertex_fetch(std::span<std::uint32_t> indices,
+                           std::span<std::byte> vertices, std::size_t stride)
+    -> std::size_t;
+
+/**
+ * @brief Reorder float vertices for vertex fetch locality.
+ *
+ * @see optimize_vertex_fetch
+ *
+ * @param indices the indices of the triangle list, remapped in place.
+ * @param vertices the float vertices, reordered in place.
+ * @param layout the layout of the vertices.
+ * @return std::size_t the number of referenced vertices.
+ */
+inline auto optimize_vertex_fetch(std::span<std::uint32_t> indices,
+                                  std::span<float> vertices,
+                                  const VertexBufferLayout& layout)
+    -> std::size_t {
+    return optimize_vertex_fetch(indices, std::as_writable_bytes(vertices),
+                                 layout.stride());
+}
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+namespace detail {
+
+/**
+ * @brief FIFO vertex cache simulation, using timestamps so that a vertex is in
+ * the cache if it was inserted less than `cache_size` insertions ago.
+ *
+ */
+class CacheSimulator {
+public:
+    CacheSimulator(std::size_t vertex_count, std::size_t cache_size)
+        : timestamps_(vertex_count, 0),
+          cache_size_{cache_size},
+          time_{cache_size + 1} {}
+
+    /**
+     * @brief Reference a vertex.
+     *
+     * @return bool whether the vertex was a cache miss.
+     */
+    auto touch(std::uint32_t vertex) noexcept -> bool {
+        if (time_ - timestamps_[vertex] > cache_size_) {
+            timestamps_[vertex] = time_++;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Empty the cache.
+     *
+     */
+    void flush() noexcept { time_ += cache_size_ + 1; }
+
+private:
+    std::vector<std::size_t> timestamps_;
+    std::size_t cache_size_;
+    std::size_t time_;
+};
+
+/**
+ * @brief Triangles adjacent to each vertex, in compressed sparse row form.
+ *
+ */
+struct Adjacency {
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> triangles;
+
+    Adjacency(std::span<const std::uint32_t> indices, std::size_t vertex_count)
+        : offsets(vertex_count + 1, 0), triangles(indices.size()) {
+        for (std::uint32_t const index : indices) {
+            ++offsets[index + 1];
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        std::vector<std::uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            triangles[cursor[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+        }
+    }
+
+    [[nodiscard]] auto of(std::uint32_t vertex) const noexcept
+        -> std::span<const std::uint32_t> {
+        return std::span{triangles}.subspan(
+            offsets[vertex], offsets[vertex + 1] - offsets[vertex]);
+    }
+};
+
+}  // namespace detail
+
+inline auto analyze_vertex_cache(std::span<const std::uint32_t> indices,
+                                 std::size_t vertex_count,
+                                 std::size_t cache_size) -> float {
+    if (indices.size() < 3) {
+        return 0.0F;
+    }
+
+    detail::CacheSimulator cache{vertex_count, cache_size};
+    std::size_t misses{};
+
+    for (std::uint32_t const index : indices) {
+        misses += cache.touch(index) ? 1 : 0;
+    }
+
+    return static_cast<float>(misses) /
+           static_cast<float>(indices.size() / 3);
+}
+
+inline void optimize_vertex_cache(std::span<std::uint32_t> indices,
+                                  std::size_t vertex_count,
+                                  std::size_t cache_size) {
+    std::size_t const triangle_count = indices.size() / 3;
+    if (triangle_count == 0 || vertex_count == 0) {
+        return;
+    }
+
+    detail::Adjacency const adjacency{indices.first(triangle_count * 3),
+                                      vertex_count};
+
+    // live triangle count and cache timestamp of each vertex
+    std::vector<std::uint32_t> live(vertex_count, 0);
+    for (std::uint32_t v = 0; v < vertex_count; ++v) {
+        live[v] = static_cast<std::uint32_t>(adjacency.of(v).size());
+    }
+    std::vector<std::size_t> timestamps(vertex_count, 0);
+    std::size_t time{cache_size + 1};
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<std::uint32_t> dead_end;
+    std::vector<std::uint32_t> candidates;
+    std::vector<std::uint32_t> result;
+    result.reserve(triangle_count * 3);
+
+    constexpr std::uint32_t none{std::numeric_limits<std::uint32_t>::max()};
+    std::uint32_t cursor{0};
+    std::uint32_t fan{0};
+
+    while (fan != none) {
+        candidates.clear();
+
+        for (std::uint32_t const triangle : adjacency.of(fan)) {
+            if (emitted[triangle]) {
+                continue;
+            }
+
+            for (std::size_t k = 0; k < 3; ++k) {
+                std::uint32_t const v = indices[triangle * 3 + k];
+
+                result.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+
+                if (time - timestamps[v] > cache_size) {
+                    timestamps[v] = time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // prefer the candidate which entered the cache the earliest, provided
+        // its remaining triangles can be emitted before it gets evicted, any
+        // live candidate beats going back to the dead-end stack
+        fan = none;
+        std::int64_t best{-1};
+        for (std::uint32_t const v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+
+            std::int64_t priority{0};
+            if (time - timestamps[v] + 2 * live[v] <= cache_size) {
+                priority = static_cast<std::int64_t>(time - timestamps[v]);
+            }
+            if (priority > best) {
+                best = priority;
+                fan = v;
+            }
+        }
+
+        if (fan != none) {
+            continue;
+        }
+
+        // dead end, go back to a recently used vertex, or the next live one
+        while (!dead_end.empty() && fan == none) {
+            std::uint32_t const v = dead_end.back();
+            dead_end.pop_back();
+            if (live[v] > 0) {
+                fan = v;
+            }
+        }
+        while (fan == none && cursor < vertex_count) {
+            if (live[cursor] > 0) {
+                fan = cursor;
+            }
+            ++cursor;
+        }
+    }
+
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+inline void optimize_overdraw(std::span<std::uint32_t> indices,
+                              std::span<const float> vertices,
+                              const VertexBufferLayout& layout,
+                              std::size_t position_attribute, float threshold,
+                              std::size_t cache_size) {
+    std::size_t const triangle_count = indices.size() / 3;
+    std::size_t const stride = layout.stride_elements();
+    if (triangle_count == 0 || stride == 0) {
+        return;
+    }
+
+    std::size_t const vertex_count = vertices.size() / stride;
+    std::size_t const position =
+        layout[position_attribute].offset / sizeof(float);
+
+    auto const position_of = [&](std::uint32_t vertex) {
+        float const* p = vertices.data() + vertex * stride + position;
+        return std::array<float, 3>{p[0], p[1], p[2]};
+    };
+
+    // hard boundaries, where every vertex of a triangle misses the cache
+    std::vector<std::size_t> clusters{0};
+    {
+        detail::CacheSimulator cache{vertex_count, cache_size};
+        for (std::size_t t = 0; t < triangle_count; ++t) {
+            std::size_t misses{};
+            for (std::size_t k = 0; k < 3; ++k) {
+                misses += cache.touch(indices[t * 3 + k]) ? 1 : 0;
+            }
+            if (misses == 3 && t != clusters.back()) {
+                clusters.push_back(t);
+            }
+        }
+    }
+    clusters.push_back(triangle_count);
+
+    // soft boundaries, once a cluster is as cache efficient as the mesh
+    float const target =
+        analyze_vertex_cache(indices.first(triangle_count * 3), vertex_count,
+                             cache_size) *
+        threshold;
+    std::vector<std::size_t> boundaries;
+    {
+        detail::CacheSimulator cache{vertex_count, cache_size};
+        for (std::size_t c = 0; c + 1 < clusters.size(); ++c) {
+            std::size_t start = clusters[c];
+            std::size_t misses{};
+            boundaries.push_back(start);
+            cache.flush();
+
+            for (std::size_t t = start; t < clusters[c + 1]; ++t) {
+                for (std::size_t k = 0; k < 3; ++k) {
+                    misses += cache.touch(indices[t * 3 + k]) ? 1 : 0;
+                }
+
+                std::size_t const end = t + 1;
+                float const ratio = static_cast<float>(misses) /
+                                    static_cast<float>(end - start);
+                if (ratio <= target && end != clusters[c + 1]) {
+                    boundaries.push_back(end);
+                    start = end;
+                    misses = 0;
+                    cache.flush();
+                }
+            }
+        }
+    }
+    boundaries.push_back(triangle_count);
+
+    // area weighted centroid of the mesh
+    std::array<float, 3> mesh_centroid{};
+    float mesh_area{};
+    std::vector<std::array<float, 6>> cluster_data;  // centroid, normal
+    cluster_data.reserve(boundaries.size() - 1);
+
+    for (std::size_t c = 0; c + 1 < boundaries.size(); ++c) {
+        std::array<float, 6> data{};
+        float area{};
+
+        for (std::size_t t = boundaries[c]; t < boundaries[c + 1]; ++t) {
+            auto const a = position_of(indices[t * 3]);
+            auto const b = position_of(indices[t * 3 + 1]);
+            auto const d = position_of(indices[t * 3 + 2]);
+
+            std::array<float, 3> const ab{b[0] - a[0], b[1] - a[1],
+                                          b[2] - a[2]};
+            std::array<float, 3> const ad{d[0] - a[0], d[1] - a[1],
+                                          d[2] - a[2]};
+            std::array<float, 3> const normal{ab[1] * ad[2] - ab[2] * ad[1],
+                                              ab[2] * ad[0] - ab[0] * ad[2],
+                                              ab[0] * ad[1] - ab[1] * ad[0]};
+            float const weight =
+                std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] +
+                          normal[2] * normal[2]);
+
+            for (std::size_t k = 0; k < 3; ++k) {
+                data[k] += (a[k] + b[k] + d[k]) / 3.0F * weight;
+                data[3 + k] += normal[k];
+                mesh_centroid[k] += (a[k] + b[k] + d[k]) / 3.0F * weight;
+            }
+            area += weight;
+        }
+
+        for (std::size_t k = 0; k < 3; ++k) {
+            data[k] = area > 0.0F ? data[k] / area : 0.0F;
+        }
+        mesh_area += area;
+        cluster_data.push_back(data);
+    }
+
+    for (float& component : mesh_centroid) {
+        component = mesh_area > 0.0F ? component / mesh_area : 0.0F;
+    }
+
+    // clusters facing away from the center are likely to occlude the others
+    std::vector<float> sort_keys;
+    sort_keys.reserve(cluster_data.size());
+    for (auto const& data : cluster_data) {
+        float const length = std::sqrt(data[3] * data[3] +
+                                       data[4] * data[4] + data[5] * data[5]);
+        float key{};
+        for (std::size_t k = 0; k < 3; ++k) {
+            key += (data[k] - mesh_centroid[k]) * data[3 + k];
+        }
+        sort_keys.push_back(length > 0.0F ? key / length : 0.0F);
+    }
+
+    std::vector<std::size_t> order(cluster_data.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t lhs, std::size_t rhs) {
+                         return sort_keys[lhs] > sort_keys[rhs];
+                     });
+
+    std::vector<std::uint32_t> result;
+    result.reserve(triangle_count * 3);
+    for (std::size_t const c : order) {
+        result.insert(result.end(), indices.begin() + boundaries[c] * 3,
+                      indices.begin() + boundaries[c + 1] * 3);
+    }
+
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+inline auto optimize_vertex_fetch(std::span<std::uint32_t> indices,
+                                  std::span<std::byte> vertices,
+                                  std::size_t stride) -> std::size_t {
+    if (stride == 0) {
+        return 0;
+    }
+
+    std::size_t const vertex_count = vertices.size() / stride;
+    constexpr std::uint32_t unset{std::numeric_limits<std::uint32_t>::max()};
+
+    std::vector<std::uint32_t> remap(vertex_count, unset);
+    std::uint32_t next{0};
+
+    for (std::uint32_t& index : indices) {
+        if (remap[index] == unset) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    std::size_t const referenced = next;
+    for (std::uint32_t& target : remap) {
+        if (target == unset) {
+            target = next++;
+        }
+    }
+
+    auto const used = vertices.first(vertex_count * stride);
+    std::vector<std::byte> const source(used.begin(), used.end());
+    for (std::size_t v = 0; v < vertex_count; ++v) {
+        std::memcpy(vertices.data() + remap[v] * stride,
+                    source.data() + v * stride, stride);
+    }
+
+    return referenced;
+}
+
+}  // namespace rgl::optimization
@@ -0,0 +1,584 @@
+#pragma once
+
+#include "gl_functions.hpp"
+#include "index_buffer.hpp"
+#include "indirect_buffer.hpp"
+#include "shader.hpp"
+#include "shader_storage_buffer.hpp"
+#include "vertex_buffer_layout.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace rgl {
+
+/**
+ * @brief A cluster of triangles of a mesh, small enough to be culled as a
+ * whole.
+ *
+ * @note Trivial, so that it can be uploaded as is to a shader storage buffer,
+ * where it maps to a `uvec4`.
+ */
+struct Meshlet {
+    std::uint32_t vertex_offset;    // first entry in MeshletMesh::vertices
+    std::uint32_t triangle_offset;  // first entry in MeshletMesh::triangles
+    std::uint32_t vertex_count;
+    std::uint32_t triangle_count;
+};
+
+/**
+ * @brief Culling bounds of a meshlet.
+ *
+ * @details `sphere` holds the center and radius of the bounding sphere, `cone`
+ * the axis of the normal cone and the sine of its half angle complement: the
+ * meshlet is backfacing when seen from `camera` if
+ * `dot(center - camera, axis) >= cutoff * length(center - camera) + radius`.
+ * A cutoff of 1 disables the test, for meshlets whose normals diverge too
+ * much.
+ *
+ * @note Trivial, maps to two `vec4` in a shader storage buffer.
+ */
+struct MeshletBounds {
+    std::array<float, 4> sphere;
+    std::array<float, 4> cone;
+};
+
+/**
+ * @brief A mesh split into meshlets.
+ *
+ * @details Each meshlet references its vertices through `vertices`, which
+ * holds indices into the vertex buffer of the mesh, and its triangles through
+ * `triangles`, which holds three 8 bit indices into the vertices of the
+ * meshlet per triangle, packed as `a | b << 8 | c << 16`.
+ *
+ */
+struct MeshletMesh {
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshletBounds> bounds;
+    std::vector<std::uint32_t> vertices;
+    std::vector<std::uint32_t> triangles;
+};
+
+/**
+ * @brief Split a triangle list into meshlets.
+ *
+ * @details Triangles are added to the current meshlet in index order until it
+ * runs out of vertices or triangles, so the triangles should first be ordered
+ * for locality, for instance with optimization::optimize_vertex_cache().
+ *
+ * @param indices the indices of the triangle list.
+ * @param vertices the float vertices the indices refer to.
+ * @param layout the layout of the vertices.
+ * @param position_attribute the index of the vec3 position attribute.
+ * @param max_vertices the maximum number of vertices of a meshlet, at most
+ * 256.
+ * @param max_triangles the maximum number of triangles of a meshlet, at most
+ * MeshletCuller::workgroup_size.
+ * @return MeshletMesh the meshlets and their bounds.
+ */
+[[nodiscard]] auto build_meshlets(std::span<const std::uint32_t> indices,
+                                  std::span<const float> vertices,
+                                  const VertexBufferLayout& layout,
+                                  std::size_t position_attribute = 0,
+                                  std::size_t max_vertices = 64,
+                                  std::size_t max_triangles = 124)
+    -> MeshletMesh;
+
+/**
+ * @brief GPU copy of a MeshletMesh, as read by MeshletCuller.
+ *
+ */
+class MeshletBuffers {
+public:
+    /**
+     * @brief Upload the meshlets, their bounds, vertices and triangles to
+     * shader storage buffers.
+     *
+     * @param mesh the meshlets to upload.
+     */
+    explicit MeshletBuffers(const MeshletMesh& mesh) noexcept;
+
+    // UTILITIES
+
+    [[nodiscard]] auto meshlets() const noexcept -> const ShaderStorageBuffer& {
+        return meshlets_;
+    }
+    [[nodiscard]] auto bounds() const noexcept -> const ShaderStorageBuffer& {
+        return bounds_;
+    }
+    [[nodiscard]] auto vertices() const noexcept -> const ShaderStorageBuffer& {
+        return vertices_;
+    }
+    [[nodiscard]] auto triangles() const noexcept
+        -> const ShaderStorageBuffer& {
+        return triangles_;
+    }
+
+    [[nodiscard]] constexpr auto meshlet_count() const noexcept
+        -> std::uint32_t {
+        return meshlet_count_;
+    }
+
+    /**
+     * @brief Get the number of indices emitted when every meshlet is visible,
+     * the size an output index buffer must have.
+     *
+     */
+    [[nodiscard]] constexpr auto max_index_count() const noexcept
+        -> std::uint32_t {
+        return triangle_count_ * 3;
+    }
+
+private:
+    ShaderStorageBuffer meshlets_;
+    ShaderStorageBuffer bounds_;
+    ShaderStorageBuffer vertices_;
+    ShaderStorageBuffer triangles_;
+
+    std::uint32_t meshlet_count_{};
+    std::uint32_t triangle_count_{};
+};
+
+/**
+ * @brief GPU-driven culling of the meshlets of a mesh.
+ *
+ * @details Runs a compute pass with one work group per meshlet. The meshlets
+ * whose bounding sphere is outside of the frustum, or whose normal cone faces
+ * away from the camera, are skipped, the triangles of the others are written
+ * as compacted 32 bit indices into an index buffer, and their number into the
+ * `count` of an indirect draw command, so that only the visible parts of the
+ * mesh are drawn, without any CPU readback.
+ *
+ * Typical usage, once per frame, with the planes and camera in the model space
+ * of the mesh:
+ *
+ * @code
+ * culler.cull(meshlets, FrustumCuller::extract_planes(model_view_proj),
+ *             camera, vao.index_data(), commands, mesh_command);
+ * vao.draw_indirect(commands);
+ * @endcode
+ *
+ * @note The order of the meshlets is not preserved.
+ *
+ * @see build_meshlets
+ * @see rgl::FrustumCuller
+ */
+class MeshletCuller {
+public:
+    /**
+     * @brief Number of invocations of a work group, one per triangle of the
+     * meshlet.
+     *
+     */
+    static constexpr std::uint32_t workgroup_size = 128;
+
+    /**
+     * @brief Construct a new meshlet culler object, compiling its compute
+     * shader.
+     *
+     */
+    MeshletCuller() noexcept;
+
+    MeshletCuller(const MeshletCuller&) = delete;
+    auto operator=(const MeshletCuller&) -> MeshletCuller& = delete;
+
+    MeshletCuller(MeshletCuller&&) noexcept = default;
+    auto operator=(MeshletCuller&&) noexcept -> MeshletCuller& = default;
+
+    ~MeshletCuller() = default;
+
+    /**
+     * @brief Cull the meshlets of a mesh against a frustum and a camera.
+     *
+     * @details Writes `command` into `commands` at `command_index`, with its
+     * index count reset to zero, then dispatches the culling pass, which
+     * writes the indices of the visible triangles into `indices`, starting at
+     * `command.first_index`, and increments the index count of the command.
+     *
+     * @warning The indirect buffer is reallocated, losing its contents, if it
+     * cannot hold `command_index + 1` commands, reserve it beforehand when it
+     * holds several commands.
+     *
+     * @param mesh the meshlets to cull.
+     * @param planes the frustum planes, in the model space of the mesh, see
+     * FrustumCuller::extract_planes().
+     * @param camera the position of the camera, in the model space of the
+     * mesh.
+     * @param indices the index buffer receiving the visible triangles, of type
+     * UNSIGNED_INT, `command.first_index` is relative to the start of its
+     * buffer object, as for any indirect draw, and at least
+     * `mesh.max_index_count()` indices must fit past it.
+     * @param commands the indirect buffer receiving the draw command.
+     * @param command the draw command of the mesh.
+     * @param command_index the index of the command in `commands`.
+     */
+    void cull(const MeshletBuffers& mesh, std::span<const float, 24> planes,
+              std::span<const float, 3> camera, const IndexBuffer& indices,
+              IndirectBuffer& commands, DrawElementsIndirectCommand command,
+              std::uint32_t command_index = 0);
+
+    // UTILITIES
+
+    [[nodiscard]] auto program() noexcept -> ShaderProgram& {
+        return program_;
+    }
+
+private:
+    static constexpr std::string_view cull_source{R"(#version 460 core
+layout(local_size_x = 128) in;
+
+struct Meshlet {
+    uint vertex_offset;
+    uint triangle_offset;
+    uint vertex_count;
+    uint triangle_count;
+};
+
+struct Bounds {
+    vec4 sphere;
+    vec4 cone;
+};
+
+layout(std430, binding = 0) readonly buffer Meshlets { Meshlet meshlets[]; };
+layout(std430, binding = 1) readonly buffer MeshletBounds { Bounds bounds[]; };
+layout(std430, binding = 2) readonly buffer Vertices { uint vertices[]; };
+layout(std430, binding = 3) readonly buffer Triangles { uint triangles[]; };
+layout(std430, binding = 4) writeonly buffer Indices { uint indices[]; };
+layout(std430, binding = 5) buffer Commands { uint commands[]; };
+
+uniform vec4 u_planes[6];
+uniform vec3 u_camera;
+uniform int u_meshlet_count;
+uniform int u_first_index;
+uniform int u_command;
+
+shared bool s_visible;
+shared uint s_base;
+
+bool is_visible(Bounds b) {
+    for (int i = 0; i < 6; ++i) {
+        if (dot(u_planes[i].xyz, b.sphere.xyz) + u_planes[i].w < -b.sphere.w) {
+            return false;
+        }
+    }
+
+    vec3 view = b.sphere.xyz - u_camera;
+    return dot(view, b.cone.xyz) < b.cone.w * length(view) + b.sphere.w;
+}
+
+void main() {
+    uint id = gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
+    if (id >= uint(u_meshlet_count)) {
+        return;
+    }
+
+    Meshlet meshlet = meshlets[id];
+    if (gl_LocalInvocationIndex == 0u) {
+        s_visible = is_visible(bounds[id]);
+        if (s_visible) {
+            // count is the first member of the command
+            s_base = atomicAdd(commands[u_command * 5],
+                               meshlet.triangle_count * 3u);
+        }
+    }
+    memoryBarrierShared();
+    barrier();
+
+    uint triangle = gl_LocalInvocationIndex;
+    if (!s_visible || triangle >= meshlet.triangle_count) {
+        return;
+    }
+
+    uint packed = triangles[meshlet.triangle_offset + triangle];
+    uint to = uint(u_first_index) + s_base + triangle * 3u;
+    for (uint k = 0u; k < 3u; ++k) {
+        uint local = (packed >> (8u * k)) & 0xFFu;
+        indices[to + k] = vertices[meshlet.vertex_offset + local];
+    }
+}
+)"};
+
+    static constexpr std::array<std::string_view, 6> plane_names{
+        "u_planes[0]", "u_planes[1]", "u_planes[2]",
+        "u_planes[3]", "u_planes[4]", "u_planes[5]"};
+
+    // work groups per dimension guaranteed by the specification
+    static constexpr std::uint32_t max_workgroups = 65535;
+
+    ShaderProgram program_;
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+namespace detail {
+
+/**
+ * @brief Compute the bounding sphere and normal cone of a meshlet.
+ *
+ */
+inline auto meshlet_bounds(const MeshletMesh& mesh, const Meshlet& meshlet,
+                           std::span<const float> vertices,
+                           std::size_t stride, std::size_t position)
+    -> MeshletBounds {
+    auto const position_of = [&](std::uint32_t local) {
+        std::uint32_t const vertex =
+            mesh.vertices[meshlet.vertex_offset + local];
+        float const* p = vertices.data() + vertex * stride + position;
+        return std::array<float, 3>{p[0], p[1], p[2]};
+    };
+
+    // sphere around the center of the bounding box
+    std::array<float, 3> low{std::numeric_limits<float>::max(),
+                             std::numeric_limits<float>::max(),
+                             std::numeric_limits<float>::max()};
+    std::array<float, 3> high{std::numeric_limits<float>::lowest(),
+                              std::numeric_limits<float>::lowest(),
+                              std::numeric_limits<float>::lowest()};
+    for (std::uint32_t v = 0; v < meshlet.vertex_count; ++v) {
+        auto const p = position_of(v);
+        for (std::size_t k = 0; k < 3; ++k) {
+            low[k] = std::min(low[k], p[k]);
+            high[k] = std::max(high[k], p[k]);
+        }
+    }
+
+    MeshletBounds bounds{};
+    for (std::size_t k = 0; k < 3; ++k) {
+        bounds.sphere[k] = (low[k] + high[k]) * 0.5F;
+    }
+
+    float radius_sq{};
+    for (std::uint32_t v = 0; v < meshlet.vertex_count; ++v) {
+        auto const p = position_of(v);
+        float distance_sq{};
+        for (std::size_t k = 0; k < 3; ++k) {
+            float const d = p[k] - bounds.sphere[k];
+            distance_sq += d * d;
+        }
+        radius_sq = std::max(radius_sq, distance_sq);
+    }
+    bounds.sphere[3] = std::sqrt(radius_sq);
+
+    // the cone axis is the average of the unit normals of the triangles
+    std::vector<std::array<float, 3>> normals;
+    normals.reserve(meshlet.triangle_count);
+    std::array<float, 3> axis{};
+
+    for (std::uint32_t t = 0; t < meshlet.triangle_count; ++t) {
+        std::uint32_t const packed =
+            mesh.triangles[meshlet.triangle_offset + t];
+        auto const a = position_of(packed & 0xFFU);
+        auto const b = position_of((packed >> 8) & 0xFFU);
+        auto const c = position_of((packed >> 16) & 0xFFU);
+
+        std::array<float, 3> const ab{b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        std::array<float, 3> const ac{c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        std::array<float, 3> normal{ab[1] * ac[2] - ab[2] * ac[1],
+                                    ab[2] * ac[0] - ab[0] * ac[2],
+                                    ab[0] * ac[1] - ab[1] * ac[0]};
+
+        float const length = std::sqrt(normal[0] * normal[0] +
+                                       normal[1] * normal[1] +
+                                       normal[2] * normal[2]);
+        if (length == 0.0F) {
+            continue;
+        }
+
+        for (std::size_t k = 0; k < 3; ++k) {
+            normal[k] /= length;
+            axis[k] += normal[k];
+        }
+        normals.push_back(normal);
+    }
+
+    float const axis_length =
+        std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    bounds.cone = {0.0F, 0.0F, 0.0F, 1.0F};
+    if (axis_length == 0.0F || normals.empty()) {
+        return bounds;
+    }
+
+    float min_dot{1.0F};
+    for (std::size_t k = 0; k < 3; ++k) {
+        axis[k] /= axis_length;
+    }
+    for (auto const& normal : normals) {
+        min_dot = std::min(min_dot, normal[0] * axis[0] + normal[1] * axis[1] +
+                                        normal[2] * axis[2]);
+    }
+
+    // wider than a hemisphere, the meshlet can be seen from anywhere
+    if (min_dot <= 0.1F) {
+        return bounds;
+    }
+
+    bounds.cone = {axis[0], axis[1], axis[2],
+                   std::sqrt(1.0F - min_dot * min_dot)};
+    return bounds;
+}
+
+}  // namespace detail
+
+inline auto build_meshlets(std::span<const std::uint32_t> indices,
+                           std::span<const float> vertices,
+                           const VertexBufferLayout& layout,
+                           std::size_t position_attribute,
+                           std::size_t max_vertices, std::size_t max_triangles)
+    -> MeshletMesh {
+    max_vertices = std::clamp<std::size_t>(max_vertices, 3, 256);
+    max_triangles = std::clamp<std::size_t>(max_triangles, 1,
+                                            MeshletCuller::workgroup_size);
+
+    MeshletMesh mesh;
+    std::size_t const stride = layout.stride_elements();
+    if (stride == 0) {
+        return mesh;
+    }
+
+    std::size_t const position =
+        layout[position_attribute].offset / sizeof(float);
+
+    constexpr std::uint32_t unset{std::numeric_limits<std::uint32_t>::max()};
+    std::vector<std::uint32_t> local(vertices.size() / stride, unset);
+    Meshlet meshlet{0, 0, 0, 0};
+
+    auto const finish = [&] {
+        if (meshlet.triangle_count == 0) {
+            return;
+        }
+
+        for (std::uint32_t v = 0; v < meshlet.vertex_count; ++v) {
+            local[mesh.vertices[meshlet.vertex_offset + v]] = unset;
+        }
+
+        mesh.meshlets.push_back(meshlet);
+        mesh.bounds.push_back(
+            detail::meshlet_bounds(mesh, meshlet, vertices, stride, position));
+
+        meshlet = {static_cast<std::uint32_t>(mesh.vertices.size()),
+                   static_cast<std::uint32_t>(mesh.triangles.size()), 0, 0};
+    };
+
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        std::array<std::uint32_t, 3> const triangle{indices[i], indices[i + 1],
+                                                    indices[i + 2]};
+
+        std::size_t added{};
+        for (std::size_t k = 0; k < 3; ++k) {
+            bool const duplicate =
+                (k > 0 && triangle[k] == triangle[0]) ||
+                (k > 1 && triangle[k] == triangle[1]);
+            added += local[triangle[k]] == unset && !duplicate ? 1 : 0;
+        }
+
+        if (meshlet.vertex_count + added > max_vertices ||
+            meshlet.triangle_count + 1 > max_triangles) {
+            finish();
+        }
+
+        std::uint32_t packed{};
+        for (std::size_t k = 0; k < 3; ++k) {
+            std::uint32_t& slot = local[triangle[k]];
+            if (slot == unset) {
+                slot = meshlet.vertex_count++;
+                mesh.vertices.push_back(triangle[k]);
+            }
+            packed |= slot << (8 * k);
+        }
+
+        mesh.triangles.push_back(packed);
+        ++meshlet.triangle_count;
+    }
+    finish();
+
+    return mesh;
+}
+
+inline MeshletBuffers::MeshletBuffers(const MeshletMesh& mesh) noexcept
+    : meshlets_{std::span<const Meshlet>{mesh.meshlets},
+                DriverDrawHint::STATIC_DRAW},
+      bounds_{std::span<const MeshletBounds>{mesh.bounds},
+              DriverDrawHint::STATIC_DRAW},
+      vertices_{std::span<const std::uint32_t>{mesh.vertices},
+                DriverDrawHint::STATIC_DRAW},
+      triangles_{std::span<const std::uint32_t>{mesh.triangles},
+                 DriverDrawHint::STATIC_DRAW},
+      meshlet_count_{static_cast<std::uint32_t>(mesh.meshlets.size())},
+      triangle_count_{static_cast<std::uint32_t>(mesh.triangles.size())} {}
+
+inline MeshletCuller::MeshletCuller() noexcept
+    : program_{"meshlet_culler",
+               {Shader{ShaderType::Compute, std::string{cull_source}}}} {}
+
+inline void MeshletCuller::cull(const MeshletBuffers& mesh,
+                                std::span<const float, 24> planes,
+                                std::span<const float, 3> camera,
+                                const IndexBuffer& indices,
+                                IndirectBuffer& commands,
+                                DrawElementsIndirectCommand command,
+                                std::uint32_t command_index) {
+#ifdef RGL_DEBUG
+    if (indices.type() != UNSIGNED_INT ||
+        indices.first_index() + static_cast<std::size_t>(indices.count()) <
+            command.first_index + mesh.max_index_count()) {
+        std::fprintf(stderr,
+                     RGL_LINEINFO
+                     ", the index buffer must hold 32 bit indices for every "
+                     "meshlet\n");
+    }
+#endif  // RGL_DEBUG
+
+    command.count = 0;
+    commands.reserve(command_index + 1);
+    commands.bind();
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER,
+                    static_cast<ptrdiff_t>(command_index * sizeof(command)),
+                    sizeof(command), &command);
+
+    std::uint32_t const count = mesh.meshlet_count();
+    if (count == 0) {
+        return;
+    }
+
+    mesh.meshlets().bind_base(0);
+    mesh.bounds().bind_base(1);
+    mesh.vertices().bind_base(2);
+    mesh.triangles().bind_base(3);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, indices.id());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, commands.id());
+
+    program_.bind();
+    for (std::size_t i = 0; i < plane_names.size(); ++i) {
+        program_.set_uniform4f(plane_names[i], planes[i * 4],
+                               planes[i * 4 + 1], planes[i * 4 + 2],
+                               planes[i * 4 + 3]);
+    }
+    program_.set_uniform3f("u_camera", camera[0], camera[1], camera[2]);
+    program_.set_uniform1i("u_meshlet_count", static_cast<int>(count));
+    program_.set_uniform1i("u_first_index",
+                           static_cast<int>(command.first_index));
+    program_.set_uniform1i("u_command", static_cast<int>(command_index));
+
+    // meshlets past the first dimension limit spill into the second one
+    std::uint32_t const groups_x = std::min(count, max_workgroups);
+    program_.dispatch(groups_x, (count + groups_x - 1) / groups_x, 1);
+
+    // the results are consumed as draw parameters and indices, and the index
+    // count is reset with glBufferSubData by the next pass
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT |
+                    GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+}  // namespace rgl
@@ -1,14 +1,23 @@
 #pragma once
 
 #include "gl_functions.hpp"
+#include "shader_reflection.hpp"
+#include "uniform_shadow.hpp"
 #include "utility.hpp"
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <exception>
+#include <filesystem>
+#include <fstream>
 #include <optional>
 #include <span>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace rgl {
@@ -30,20 +39,179 @@ enum class ShaderType {
 
 inline std::string shader_type_to_string(ShaderType type) noexcept;
 
+/**
+ * @brief How a shader program is compiled and linked.
+ *
+ * @details
+ * - `sync`: the constructor blocks until the program is linked.
+ * - `async`: the constructor only submits the compilation and the link, the
+ *   driver works on them in the background, with GL_KHR_parallel_shader_compile
+ *   on several threads, and the program reports when it is ready.
+ *
+ */
+enum class CompileMode : std::uint8_t {
+    sync,
+    async,
+};
+
+/**
+ * @brief The state of the compilation of a shader program.
+ *
+ */
+enum class ProgramStatus : std::uint8_t {
+    compiling,
+    ready,
+    failed,
+};
+
+/**
+ * @brief How the uniforms of a shader program are uploaded.
+ *
+ * @details
+ * - `bound`: with glUniform*, to the program currently bound, which has to be
+ *   the program being uploaded to.
+ * - `direct`: with glProgramUniform*, to the program object itself, whether
+ *   it is bound or not, which saves the bind when uniforms are uploaded ahead
+ *   of the draws.
+ *
+ */
+enum class UniformUpload : std::uint8_t {
+    bound,
+    direct,
+};
+
+/**
+ * @brief The format of the source of a shader.
+ *
+ * @details
+ * - `glsl`: GLSL source, compiled by the driver.
+ * - `spirv`: SPIR-V module compiled offline, which skips the GLSL front-end of
+ *   the driver, see GL_ARB_gl_spirv.
+ *
+ */
+enum class ShaderFormat : std::uint8_t {
+    glsl,
+    spirv,
+};
+
+/**
+ * @brief A specialization constant of a SPIR-V shader.
+ *
+ * @details The value holds the bits of the constant, floats are given with
+ * `std::bit_cast<std::uint32_t>`.
+ *
+ */
+struct SpecializationConstant {
+    std::uint32_t id;
+    std::uint32_t value;
+};
+
 /**
  * @brief Individual shader struct.
  *
  * @details The shader struct is effectively nothing more that a string that is
  * tagged with a shader type.
  *
+ * SPIR-V shaders hold the bytes of the module in their source, along with the
+ * entry point and the specialization constants to specialize it with.
+ *
+ * @code
+ * Shader shader{ShaderType::fragment, util::read_file("lit.frag.spv"),
+ *               ShaderFormat::spirv, "main", {{0, 4}}};
+ * @endcode
+ *
  * @see rgl::shader_type
  *
  */
 struct Shader {
     ShaderType type;
     std::string source;
+
+    ShaderFormat format{ShaderFormat::glsl};
+    std::string entry_point{"main"};
+    std::vector<SpecializationConstant> constants{};
+};
+
+/**
+ * @brief A file the sources of a shader program were read from.
+ *
+ * @details Files without a type hold several shaders, separated by the `#type`
+ * tag.
+ *
+ */
+struct ShaderFile {
+    std::string path;
+    std::optional<ShaderType> type;
+};
+
+/**
+ * @brief A uniform name along with its hash.
+ *
+ * @see rgl::UniformId
+ */
+struct HashedUniform {
+    // null-terminated
+    std::string_view name;
+    std::uint64_t hash;
+};
+
+/**
+ * @brief A uniform name hashed at compile time.
+ *
+ * @code
+ * program.set(UniformId<"u_model">, model);
+ * @endcode
+ *
+ */
+template <util::FixedString Name>
+inline constexpr HashedUniform UniformId{Name.view(),
+                                         util::fnv1a_literal(Name.view())};
+
+namespace detail {
+
+/**
+ * @brief Cache of uniform locations keyed by the hashes of their names, a flat
+ * open addressing table with linear probing.
+ *
+ * @details The names are stored along with the hashes and compared when the
+ * hashes match, so that colliding names keep their own locations.
+ *
+ */
+class UniformLocationCache {
+public:
+    /**
+     * @brief Find the location of a uniform.
+     *
+     * @param uniform the name of the uniform and its hash.
+     * @return const std::int32_t* the location, nullptr if not cached.
+     */
+    [[nodiscard]] auto find(HashedUniform uniform) const noexcept
+        -> const std::int32_t*;
+
+    void insert(HashedUniform uniform, std::int32_t location);
+
+    void clear() noexcept {
+        slots_.clear();
+        size_ = 0;
+    }
+
+private:
+    struct Slot {
+        std::string name;
+        std::uint64_t hash;
+        std::int32_t location;
+        bool used;
+    };
+
+    void grow();
+
+    // the capacity is a power of two, kept at most 3/4 full
+    std::vector<Slot> slots_;
+    std::size_t size_{};
 };
 
+}  // namespace detail
+
 /**
  * @brief Shader program class.
  *
@@ -52,7 +220,34 @@ struct Shader {
  * for actions such as uploading uniforms.
  *
  * Each shader program has it's own internal cache of uniform locations. this
- * avoids expensive API calls on each uniform upload.
+ * avoids expensive API calls on each uniform upload. Uniforms named with
+ * UniformId are hashed at compile time, so that set() only probes the cache.
+ *
+ * Uploads are checked against a shadow copy of the uniforms, and only reach
+ * the driver when the value changed, see uniform_stats(). Arrays are uploaded
+ * with a single call, see set_uniform_mat4fv(), and uniforms can be uploaded
+ * without binding the program, see set_uniform_upload().
+ *
+ * Linked programs are also reflected, see reflection(): uniforms can be
+ * resolved once into handles, which are then uploaded to without any lookup.
+ *
+ * Programs can be compiled asynchronously: submitting every program first and
+ * polling them afterwards lets the driver compile them in parallel, while the
+ * application keeps running.
+ *
+ * @code
+ * ShaderProgram program{"lit", "shaders/lit.glsl", CompileMode::async};
+ * // every frame
+ * if (program.ready()) {
+ *     program.bind();
+ * }
+ * @endcode
+ *
+ * Linked programs can also be cached on disk, see set_binary_cache(), so that
+ * later runs skip the compilation altogether.
+ *
+ * Programs loaded from files remember them and can be reloaded, see reload()
+ * and rgl::ShaderWatcher.
  *
  * @note if utilizing paths to load the shaders, it is important to note that
  * they will be relative to the current working directory when running the
@@ -74,8 +269,10 @@ public:
      * @param name Shader program name, for debugging purposes.
      * @param path Shader program path, currently it must be relative to the
      * current working directory.
+     * @param mode whether to wait for the program to be linked.
      */
-    ShaderProgram(std::string_view name, std::string_view path) noexcept;
+    ShaderProgram(std::string_view name, std::string_view path,
+                  CompileMode mode = CompileMode::sync) noexcept;
 
     /**
      * @brief Construct a new shader program object from a name and a list of
@@ -88,10 +285,30 @@ public:
      * @param name Shader name, for debugging purposes.
      * @param shaders A list of shader sources, each shader source is a pair of
      * shader type and shader source.
+     * @param mode whether to wait for the program to be linked.
+     *
+     * @note Files with the `.spv` extension are loaded as SPIR-V modules,
+     * with the `main` entry point.
      */
     ShaderProgram(std::string_view name,
                   std::initializer_list<std::pair<ShaderType, std::string_view>>
-                      shaders) noexcept;
+                      shaders,
+                  CompileMode mode = CompileMode::sync) noexcept;
+
+    /**
+     * @brief Construct a new shader program object from a name and a list of
+     * in-memory shaders.
+     *
+     * @details This constructor is to be used when the shader sources are
+     * already loaded or generated at runtime, for instance the compute shaders
+     * embedded in the library.
+     *
+     * @param name Shader program name, for debugging purposes.
+     * @param shaders The shaders of the program, with their sources.
+     * @param mode whether to wait for the program to be linked.
+     */
+    ShaderProgram(std::string_view name, std::vector<Shader> shaders,
+                  CompileMode mode = CompileMode::sync) noexcept;
 
     /**
      * @brief Construct a new shader program object from a path.
@@ -105,27 +322,46 @@ public:
      *
      * @param path Shader program path, currently it must be relative to the
      * current working directory.
+     * @param mode whether to wait for the program to be linked.
      */
-    ShaderProgram(std::string_view path) noexcept;
+    ShaderProgram(std::string_view path,
+                  CompileMode mode = CompileMode::sync) noexcept;
 
-    ShaderProgram(const ShaderProgram&) = default;
-    auto operator=(const ShaderProgram&) -> ShaderProgram& = default;
+    ShaderProgram(const ShaderProgram&) = delete;
+    auto operator=(const ShaderProgram&) -> ShaderProgram& = delete;
 
     ShaderProgram(ShaderProgram&& other) noexcept
         : shaders_{std::move(other.shaders_)},
           uniform_cache_{std::move(other.uniform_cache_)},
           id_{other.id_},
-          name_{std::move(other.name_)} {
+          name_{std::move(other.name_)},
+          pending_shaders_{std::move(other.pending_shaders_)},
+          status_{other.status_},
+          files_{std::move(other.files_)},
+          reflection_{std::move(other.reflection_)},
+          shadow_{std::move(other.shadow_)},
+          upload_{other.upload_} {
         other.id_ = 0;
+        other.pending_shaders_.clear();
+        other.status_ = ProgramStatus::failed;
     }
 
     auto operator=(ShaderProgram&& other) noexcept -> ShaderProgram& {
         if (this != &other) {
+            release();
             shaders_ = std::move(other.shaders_);
             uniform_cache_ = std::move(other.uniform_cache_);
             id_ = other.id_;
             name_ = std::move(other.name_);
+            pending_shaders_ = std::move(other.pending_shaders_);
+            status_ = other.status_;
+            files_ = std::move(other.files_);
+            reflection_ = std::move(other.reflection_);
+            shadow_ = std::move(other.shadow_);
+            upload_ = other.upload_;
             other.id_ = 0;
+            other.pending_shaders_.clear();
+            other.status_ = ProgramStatus::failed;
         }
         return *this;
     }
@@ -149,6 +385,16 @@ public:
      */
     void unbind() const;
 
+    /**
+     * @brief Launch the compute shader of the program.
+     *
+     * @note The program must be bound, the dispatch is followed by a
+     * GL_SHADER_STORAGE_BARRIER_BIT memory barrier.
+     *
+     * @param x the number of work groups in the X dimension.
+     * @param y the number of work groups in the Y dimension.
+     * @param z the number of work groups in the Z dimension.
+     */
     void dispatch(unsigned int x, unsigned int y, unsigned int z) const;
 
     void set_uniform1i(std::string_view name, int val);
@@ -199,7 +445,8 @@ public:
      * @param name Uniform name.
      * @param mat Contiguous span of 16 floats representing the matrix.
      */
-    void set_uniform_mat4f(std::string_view name, std::span<float, 16> mat);
+    void set_uniform_mat4f(std::string_view name,
+                           std::span<const float, 16> mat);
 
     /**
      * @brief Upload a 3x3 float matrix uniform to the shader program.
@@ -208,158 +455,765 @@ public:
      * @param mat Contiguous span of 9 9 9 9 9 9 9 9 9 floats representing the
      * matrix.
      */
-    void set_uniform_mat3f(std::string_view name, std::span<float, 9> mat);
+    void set_uniform_mat3f(std::string_view name,
+                           std::span<const float, 9> mat);
 
     /**
-     * @brief Obtain the shader program id.
+     * @brief Upload a uniform to the shader program, named with UniformId.
      *
-     * @return std::uint32_t the shader program id in the OpenGL context.
+     * @code
+     * program.set(UniformId<"u_time">, time);
+     * @endcode
+     *
+     * @param uniform Uniform name and hash.
+     * @param val Uniform value.
      */
-    [[nodiscard]] auto constexpr program_id() const -> std::uint32_t;
+    void set(HashedUniform uniform, int val);
+
+    void set(HashedUniform uniform, float val);
+
+    void set(HashedUniform uniform, const std::array<float, 2>& val);
+
+    void set(HashedUniform uniform, const std::array<float, 3>& val);
+
+    void set(HashedUniform uniform, const std::array<float, 4>& val);
+
+    void set(HashedUniform uniform, std::span<const float, 16> mat);
+
+    void set(HashedUniform uniform, std::span<const float, 9> mat);
 
     /**
-     * @brief Obtain the shader program name.
+     * @brief Upload an int uniform to the shader program, through a handle
+     * resolved with uniform().
      *
-     * @return std::string the shader program name.
+     * @details The handle overloads index the reflection table instead of
+     * looking the name up, invalid handles are ignored.
+     *
+     * @param handle Uniform handle.
+     * @param val Uniform value.
      */
-    [[nodiscard]] auto constexpr name() const -> std::string;
+    void set_uniform1i(UniformHandle handle, int val);
+
+    void set_uniform1f(UniformHandle handle, float val);
+
+    void set_uniform2f(UniformHandle handle, float val0, float val1);
+
+    void set_uniform3f(UniformHandle handle, float val0, float val1,
+                       float val2);
+
+    void set_uniform4f(UniformHandle handle, float val0, float val1,
+                       float val2, float val3);
+
+    void set_uniform_mat4f(UniformHandle handle,
+                           std::span<const float, 16> mat);
+
+    void set_uniform_mat3f(UniformHandle handle,
+                           std::span<const float, 9> mat);
 
-public:
     /**
-     * @brief Obtain a reference to a shader in the shader program.
+     * @brief Upload consecutive elements of an int array uniform to the shader
+     * program, with a single call.
      *
-     * @param index Shader index.
-     * @see rgl::shader
-     * @return shader&, a reference to the shader.
+     * @details The array overloads upload every element at once, with the
+     * count of glUniform*v, instead of one call per element.
+     *
+     * @code
+     * // 128 bone matrices, uploaded with a single glUniformMatrix4fv
+     * std::vector<std::array<float, 16>> bones(128);
+     * program.set_uniform_mat4fv("u_bones", bones);
+     * @endcode
+     *
+     * @note The name may address an element, e.g. `u_bones[4]`, to upload the
+     * elements from it onwards.
+     *
+     * @param name Uniform name.
+     * @param vals Uniform values, one per element.
      */
-    auto operator[](std::size_t index) -> Shader&;
+    void set_uniform1iv(std::string_view name, std::span<const int> vals);
+
+    void set_uniform1fv(std::string_view name, std::span<const float> vals);
+
+    void set_uniform2fv(std::string_view name,
+                        std::span<const std::array<float, 2>> vals);
+
+    void set_uniform3fv(std::string_view name,
+                        std::span<const std::array<float, 3>> vals);
+
+    void set_uniform4fv(std::string_view name,
+                        std::span<const std::array<float, 4>> vals);
+
+    void set_uniform_mat4fv(std::string_view name,
+                            std::span<const std::array<float, 16>> mats);
+
+    void set_uniform_mat3fv(std::string_view name,
+                            std::span<const std::array<float, 9>> mats);
 
     /**
-     * @brief Obtain a const reference to a shader in the shader program.
+     * @brief Upload consecutive elements of an array uniform to the shader
+     * program, named with UniformId.
      *
-     * @param index Shader index.
-     * @see rgl::shader
-     * @return const shader&, a const reference to the shader.
+     * @code
+     * program.set_array(UniformId<"u_bones">, bones);
+     * @endcode
+     *
+     * @param uniform Uniform name and hash.
+     * @param vals Uniform values, one per element.
      */
-    auto operator[](std::size_t index) const -> const Shader&;
+    void set_array(HashedUniform uniform, std::span<const int> vals);
+
+    void set_array(HashedUniform uniform, std::span<const float> vals);
+
+    void set_array(HashedUniform uniform,
+                   std::span<const std::array<float, 2>> vals);
+
+    void set_array(HashedUniform uniform,
+                   std::span<const std::array<float, 3>> vals);
+
+    void set_array(HashedUniform uniform,
+                   std::span<const std::array<float, 4>> vals);
+
+    void set_array(HashedUniform uniform,
+                   std::span<const std::array<float, 16>> mats);
+
+    void set_array(HashedUniform uniform,
+                   std::span<const std::array<float, 9>> mats);
 
     /**
-     * @brief Check if a shader program is valid.
+     * @brief Upload consecutive elements of an array uniform to the shader
+     * program, through a handle resolved with uniform().
      *
-     * @details A shader program is valid if it is compiled and linked.
+     * @param handle Uniform handle, of the first element.
+     * @param vals Uniform values, one per element.
+     */
+    void set_uniform1iv(UniformHandle handle, std::span<const int> vals);
+
+    void set_uniform1fv(UniformHandle handle, std::span<const float> vals);
+
+    void set_uniform2fv(UniformHandle handle,
+                        std::span<const std::array<float, 2>> vals);
+
+    void set_uniform3fv(UniformHandle handle,
+                        std::span<const std::array<float, 3>> vals);
+
+    void set_uniform4fv(UniformHandle handle,
+                        std::span<const std::array<float, 4>> vals);
+
+    void set_uniform_mat4fv(UniformHandle handle,
+                            std::span<const std::array<float, 16>> mats);
+
+    void set_uniform_mat3fv(UniformHandle handle,
+                            std::span<const std::array<float, 9>> mats);
+
+    /**
+     * @brief Choose how the uniforms are uploaded, to the bound program or
+     * directly to the program object.
      *
-     * @param id Shader program id.
+     * @details With UniformUpload::direct, every setter goes through
+     * glProgramUniform* and the program does not have to be bound.
+     *
+     * @code
+     * program.set_uniform_upload(UniformUpload::direct);
+     * program.set_uniform_mat4fv("u_bones", bones);  // no bind() needed
+     * @endcode
      *
-     * @return true, if the shader program is valid.
-     * @return false, if the shader program is not valid.
      */
-    [[nodiscard]] static auto is_valid(std::uint32_t id) -> bool;
+    void set_uniform_upload(UniformUpload upload) noexcept {
+        upload_ = upload;
+    }
+
+    [[nodiscard]] constexpr auto uniform_upload() const noexcept
+        -> UniformUpload {
+        return upload_;
+    }
 
-private:
     /**
-     * @brief Create a program object.
+     * @brief Get the counters of the uploads issued to the driver and of the
+     * uploads skipped because the value did not change.
      *
-     * @return std::uint32_t, the program object id.
      */
-    [[nodiscard]] auto create_program() const -> std::uint32_t;
+    [[nodiscard]] auto uniform_stats() const noexcept -> UniformStats {
+        return shadow_.stats();
+    }
+
+    void reset_uniform_stats() noexcept { shadow_.reset_stats(); }
 
     /**
-     * @brief Create a shader object.
+     * @brief Forget the uploaded values, so that the next uploads are all
+     * issued, for instance after uploading uniforms of the program without
+     * going through it.
      *
-     * @param shader_type The shader type.
-     * @see rgl::shader_type
-     * @param source The shader source.
-     * @return std::uint32_t, the shader object id.
      */
-    [[nodiscard]] auto compile(ShaderType shader_type,
-                               std::string_view source) const -> std::uint32_t;
+    void invalidate_uniforms() noexcept { shadow_.invalidate(); }
 
     /**
-     * @brief Link the shader program.
-     * @details This method acts on the provided source of shaders, it will
-     * pre-process the source, splitting the monolithic source into individual
-     * shader sources by scanning for the #type tag.
+     * @brief Resolve the name of an active uniform into a handle.
      *
-     * @param source The shader program source.
-     * @see rgl::shader_type
+     * @note Handles are invalidated when the program object is replaced, see
+     * replace(), stale handles are then ignored by the setters.
      *
-     * @warning In the case of a failure in parsing, such as an invalid shader
-     * type, this method will return an empty vector.
+     * @return UniformHandle the handle, invalid if the uniform is not active.
+     */
+    [[nodiscard]] auto uniform(std::string_view name) const -> UniformHandle;
+
+    /**
+     * @brief Get the reflection of the active uniforms and blocks of the
+     * program, empty until the program is ready.
      *
-     * @return std::vector<shader>. A vector of shaders.
      */
-    [[nodiscard]] auto parse_shaders(std::string_view source) const
-        -> std::vector<Shader>;
+    [[nodiscard]] auto reflection() const noexcept
+        -> const ProgramReflection& {
+        return reflection_;
+    }
 
-private:
     /**
-     * @brief Obtain the location of a uniform in the shader program.
+     * @brief Assign a binding point to a uniform block.
      *
-     * @param name Uniform name.
-     * @return int, the uniform location.
+     * @param handle the block, resolved with reflection().
+     * @param binding the uniform buffer binding point.
      */
-    [[nodiscard]] auto uniform_location(std::string_view name) -> int;
+    void bind_uniform_block(UniformBlockHandle handle,
+                            std::uint32_t binding) const;
 
-private:
     /**
-     * @brief Convert a shader type to its OpenGL equivalent.
+     * @brief Assign a binding point to a shader storage block.
      *
-     * @see rgl::shader_type
-     * @param shader_type the shader type.
-     * @return std::uint32_t, the OpenGL equivalent of the shader type, as an
-     * OpenGL enum.
+     * @param handle the block, resolved with reflection().
+     * @param binding the shader storage buffer binding point.
      */
-    static constexpr auto to_gl_type(ShaderType shader_type) -> std::uint32_t;
+    void bind_storage_block(StorageBlockHandle handle,
+                            std::uint32_t binding) const;
 
     /**
-     * @brief Convert a string to a shader type.
+     * @brief Check whether the program is linked and can be used, finishing
+     * an asynchronous compilation if the driver is done with it.
      *
-     * @param str The string to convert.
+     * @details Never blocks with GL_KHR_parallel_shader_compile, without it
+     * the first call waits for the link, as a synchronous compilation would.
      *
-     * @return shader_type, the shader type.
+     * @return true if the program can be bound.
      */
-    [[nodiscard]] static auto string_to_shader_type(std::string_view str)
-        -> std::optional<ShaderType>;
+    auto ready() -> bool;
 
-private:
-    std::vector<Shader> shaders_;
-    std::unordered_map<std::string_view, int> uniform_cache_;
-    std::uint32_t id_{};
-    std::string name_;
-};
+    /**
+     * @brief Get the state of the compilation, without polling the driver.
+     *
+     * @see ready
+     */
+    [[nodiscard]] constexpr auto status() const noexcept -> ProgramStatus {
+        return status_;
+    }
 
-/*
+    /**
+     * @brief Set the number of threads the driver may use to compile shaders
+     * in the background.
+     *
+     * @note Does nothing without GL_KHR_parallel_shader_compile.
+     *
+     * @param count the number of threads, 0 disables parallel compilation and
+     * max_compiler_threads lets the driver decide.
+     */
+    static void set_compiler_threads(std::uint32_t count) noexcept;
 
-        IMPLEMENTATIONS
+    /**
+     * @brief Thread count letting the driver decide, see
+     * set_compiler_threads().
+     *
+     */
+    static constexpr std::uint32_t max_compiler_threads = 0xFFFFFFFF;
 
-*/
+    /**
+     * @brief Check whether the driver compiles shaders in parallel, with
+     * GL_KHR_parallel_shader_compile.
+     *
+     */
+    [[nodiscard]] static auto parallel_compile_supported() noexcept -> bool;
 
-inline ShaderProgram::ShaderProgram(std::string_view name,
-                                    std::string_view path) noexcept
-    : shaders_{parse_shaders(util::read_file(path))},
-      uniform_cache_{},
-      id_(create_program()),
-      name_{name} {}
+    /**
+     * @brief Cache the binaries of the linked programs in a directory.
+     *
+     * @details Programs created afterwards are loaded with glProgramBinary
+     * when the directory holds a binary for their sources and for the current
+     * driver, and are compiled from source and stored otherwise. A binary
+     * rejected by the driver, for instance after a driver update, is deleted
+     * and the program is compiled from source.
+     *
+     * @note The binaries are keyed by a hash of the shader sources and of the
+     * vendor, renderer and version strings of the context.
+     *
+     * @param directory the cache directory, created if it does not exist, an
+     * empty path disables the cache.
+     */
+    static void set_binary_cache(std::string_view directory);
 
-inline ShaderProgram::ShaderProgram(
-    std::string_view name,
-    std::initializer_list<std::pair<ShaderType, std::string_view>>
-        shaders) noexcept
-    : name_{name} {
-    for (const auto& [type, path] : shaders)
-        shaders_.push_back({type, util::read_file(path)});
+    /**
+     * @brief Compile the program again from its files.
+     *
+     * @details The files are read again, the program is left untouched and a
+     * new program is returned, to be given to replace() once ready.
+     *
+     * @note Programs created from in-memory sources are compiled again from
+     * the same sources.
+     *
+     * @param mode whether to wait for the new program to be linked.
+     * @return ShaderProgram the new program.
+     */
+    [[nodiscard]] auto recompile(CompileMode mode = CompileMode::sync) const
+        -> ShaderProgram;
 
-    id_ = create_program();
-}
+    /**
+     * @brief Take over the program object of another program, if it linked.
+     *
+     * @details The program keeps its name and its files, its previous program
+     * object is handed to `program` and deleted along with it. Nothing
+     * changes if `program` failed or is still compiling.
+     *
+     * @note The values uploaded through the setters are uploaded again to
+     * the new program object, by name, for the uniforms it still has with the
+     * same type. Handles have to be resolved again.
+     *
+     * @param program the program to take the program object of.
+     * @return true if the program object was replaced.
+     */
+    auto replace(ShaderProgram&& program) -> bool;
 
-inline ShaderProgram::ShaderProgram(std::string_view path) noexcept
-    : ShaderProgram{util::get_file_name(path), path} {}
+    /**
+     * @brief Read the files of the program and compile it again, keeping the
+     * current program object if the new one fails to compile or link.
+     *
+     * @return true if the program object was replaced.
+     */
+    auto reload() -> bool;
 
-inline ShaderProgram::~ShaderProgram() { glDeleteProgram(id_); }
+    /**
+     * @brief Get the files the program was read from.
+     *
+     */
+    [[nodiscard]] auto files() const noexcept -> std::span<const ShaderFile> {
+        return files_;
+    }
 
-inline void ShaderProgram::bind() const { glUseProgram(id_); }
+    /**
+     * @brief Split a shader program source into shader sources.
+     * @details This method acts on the provided source of shaders, it will
+     * pre-process the source, splitting the monolithic source into individual
+     * shader sources by scanning for the #type tag.
+     *
+     * @param source The shader program source.
+     * @see rgl::shader_type
+     *
+     * @warning In the case of a failure in parsing, such as an invalid shader
+     * type, this method will return an empty vector.
+     *
+     * @return std::vector<shader>. A vector of shaders.
+     */
+    [[nodiscard]] static auto parse_shaders(std::string_view source)
+        -> std::vector<Shader>;
 
-inline void ShaderProgram::unbind() const { glUseProgram(0); }
+    /**
+     * @brief Obtain the shader program id.
+     *
+     * @return std::uint32_t the shader program id in the OpenGL context.
+     */
+    [[nodiscard]] auto constexpr program_id() const -> std::uint32_t;
+
+    /**
+     * @brief Obtain the shader program name.
+     *
+     * @return std::string the shader program name.
+     */
+    [[nodiscard]] auto constexpr name() const -> std::string;
+
+public:
+    /**
+     * @brief Obtain a reference to a shader in the shader program.
+     *
+     * @param index Shader index.
+     * @see rgl::shader
+     * @return shader&, a reference to the shader.
+     */
+    auto operator[](std::size_t index) -> Shader&;
+
+    /**
+     * @brief Obtain a const reference to a shader in the shader program.
+     *
+     * @param index Shader index.
+     * @see rgl::shader
+     * @return const shader&, a const reference to the shader.
+     */
+    auto operator[](std::size_t index) const -> const Shader&;
+
+    /**
+     * @brief Check if a shader program is valid.
+     *
+     * @details A shader program is valid if it is compiled and linked.
+     *
+     * @param id Shader program id.
+     *
+     * @return true, if the shader program is valid.
+     * @return false, if the shader program is not valid.
+     */
+    [[nodiscard]] static auto is_valid(std::uint32_t id) -> bool;
+
+private:
+    /**
+     * @brief Create the program object, compiling and linking the shaders.
+     *
+     * @details Only submits the work in asynchronous mode, see finish().
+     *
+     * @param mode whether to wait for the program to be linked.
+     */
+    void create_program(CompileMode mode);
+
+    /**
+     * @brief Check the result of the link, report the errors and delete the
+     * shader objects, the program object is deleted if the link failed.
+     *
+     */
+    void finish();
+
+    /**
+     * @brief Load the program from the binary cache.
+     *
+     * @return true if the driver accepted the cached binary.
+     */
+    auto load_binary() -> bool;
+
+    /**
+     * @brief Store the binary of the linked program in the binary cache.
+     *
+     */
+    void store_binary() const;
+
+    /**
+     * @brief Get the path of the program in the binary cache.
+     *
+     */
+    [[nodiscard]] auto binary_path() const -> std::filesystem::path;
+
+    /**
+     * @brief Delete the program object and the pending shader objects.
+     *
+     */
+    void release() noexcept;
+
+    /**
+     * @brief Create a shader object and submit its compilation, or its
+     * specialization for SPIR-V shaders.
+     *
+     * @note The compilation status is only checked once the program is
+     * linked, so that the driver is never waited for in between.
+     *
+     * @param shader The shader, with its source.
+     * @see rgl::Shader
+     * @return std::uint32_t, the shader object id.
+     */
+    [[nodiscard]] auto compile(const Shader& shader) const -> std::uint32_t;
+
+private:
+    /**
+     * @brief Obtain the location of a uniform in the shader program.
+     *
+     * @param name Uniform name.
+     * @return int, the uniform location.
+     */
+    [[nodiscard]] auto uniform_location(std::string_view name) -> int;
+
+    /**
+     * @brief Obtain the location of a uniform in the shader program, from the
+     * hash of its name.
+     *
+     * @param uniform Uniform name and hash.
+     * @return int, the uniform location.
+     */
+    [[nodiscard]] auto uniform_location(HashedUniform uniform) -> int;
+
+    /**
+     * @brief Upload consecutive int uniforms if their values differ from the
+     * shadow copy, with glUniform1iv or glProgramUniform1iv.
+     *
+     * @param location Uniform location, of the first element.
+     * @param vals Uniform values, one per element.
+     */
+    void upload_ints(int location, std::span<const int> vals);
+
+    /**
+     * @brief Upload consecutive float vector uniforms if their values differ
+     * from the shadow copy.
+     *
+     * @param location Uniform location, of the first element.
+     * @param vals Uniform values, the components of the elements.
+     * @param components the number of components of an element, 1 to 4.
+     */
+    void upload_floats(int location, std::span<const float> vals,
+                       std::size_t components);
+
+    /**
+     * @brief Upload consecutive float matrix uniforms if their values differ
+     * from the shadow copy.
+     *
+     * @param location Uniform location, of the first element.
+     * @param mats Uniform values, the columns of the elements.
+     * @param size the number of floats of an element, 9 or 16.
+     */
+    void upload_matrices(int location, std::span<const float> mats,
+                         std::size_t size);
+
+    /**
+     * @brief Upload the values of the uniforms of a previous program object to
+     * the current one, matching the uniforms by name and type.
+     *
+     * @param reflection the reflection of the previous program object.
+     * @param shadow the values uploaded to the previous program object.
+     */
+    void restore_uniforms(const ProgramReflection& reflection,
+                          const UniformShadow& shadow);
+
+    /**
+     * @brief View consecutive vectors or matrices as their floats.
+     *
+     */
+    template <std::size_t N>
+    [[nodiscard]] static auto flatten(
+        std::span<const std::array<float, N>> vals) noexcept
+        -> std::span<const float>;
+
+private:
+    /**
+     * @brief Convert a shader type to its OpenGL equivalent.
+     *
+     * @see rgl::shader_type
+     * @param shader_type the shader type.
+     * @return std::uint32_t, the OpenGL equivalent of the shader type, as an
+     * OpenGL enum.
+     */
+    static constexpr auto to_gl_type(ShaderType shader_type) -> std::uint32_t;
+
+    /**
+     * @brief Convert a string to a shader type.
+     *
+     * @param str The string to convert.
+     *
+     * @return shader_type, the shader type.
+     */
+    [[nodiscard]] static auto string_to_shader_type(std::string_view str)
+        -> std::optional<ShaderType>;
+
+private:
+    std::vector<Shader> shaders_;
+    detail::UniformLocationCache uniform_cache_;
+    std::uint32_t id_{};
+    std::string name_;
+
+    // shaders attached to a program whose link is not checked yet
+    std::vector<std::uint32_t> pending_shaders_;
+    ProgramStatus status_{ProgramStatus::failed};
+    std::vector<ShaderFile> files_;
+    ProgramReflection reflection_;
+    UniformShadow shadow_;
+    UniformUpload upload_{UniformUpload::bound};
+
+    static inline std::filesystem::path binary_cache_;
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+inline auto detail::UniformLocationCache::find(
+    HashedUniform uniform) const noexcept -> const std::int32_t* {
+    if (slots_.empty()) {
+        return nullptr;
+    }
+
+    const std::size_t mask = slots_.size() - 1;
+    for (std::size_t i = uniform.hash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots_[i];
+        if (!slot.used) {
+            return nullptr;
+        }
+        if (slot.hash == uniform.hash && slot.name == uniform.name) {
+            return &slot.location;
+        }
+    }
+}
+
+inline void detail::UniformLocationCache::insert(HashedUniform uniform,
+                                                 std::int32_t location) {
+    if ((size_ + 1) * 4 > slots_.size() * 3) {
+        grow();
+    }
+
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t i = uniform.hash & mask;
+    while (slots_[i].used && (slots_[i].hash != uniform.hash ||
+                              slots_[i].name != uniform.name)) {
+        i = (i + 1) & mask;
+    }
+
+    size_ += slots_[i].used ? 0 : 1;
+    slots_[i] = {std::string{uniform.name}, uniform.hash, location, true};
+}
+
+inline void detail::UniformLocationCache::grow() {
+    std::vector<Slot> slots(std::max<std::size_t>(16, slots_.size() * 2));
+    std::swap(slots, slots_);
+
+    const std::size_t mask = slots_.size() - 1;
+    for (auto& slot : slots) {
+        if (!slot.used) {
+            continue;
+        }
+
+        std::size_t i = slot.hash & mask;
+        while (slots_[i].used) {
+            i = (i + 1) & mask;
+        }
+        slots_[i] = std::move(slot);
+    }
+}
+
+inline ShaderProgram::ShaderProgram(std::string_view name,
+                                    std::string_view path,
+                                    CompileMode mode) noexcept
+    : shaders_{parse_shaders(util::read_file(path))},
+      uniform_cache_{},
+      name_{name},
+      files_{{std::string{path}, std::nullopt}} {
+    create_program(mode);
+}
+
+inline ShaderProgram::ShaderProgram(
+    std::string_view name,
+    std::initializer_list<std::pair<ShaderType, std::string_view>> shaders,
+    CompileMode mode) noexcept
+    : name_{name} {
+    for (const auto& [type, path] : shaders) {
+        const ShaderFormat format = path.ends_with(".spv")
+                                        ? ShaderFormat::spirv
+                                        : ShaderFormat::glsl;
+        shaders_.push_back({type, util::read_file(path), format});
+        files_.push_back({std::string{path}, type});
+    }
+
+    create_program(mode);
+}
+
+inline ShaderProgram::ShaderProgram(std::string_view name,
+                                    std::vector<Shader> shaders,
+                                    CompileMode mode) noexcept
+    : shaders_{std::move(shaders)},
+      uniform_cache_{},
+      name_{name} {
+    create_program(mode);
+}
+
+inline ShaderProgram::ShaderProgram(std::string_view path,
+                                    CompileMode mode) noexcept
+    : ShaderProgram{util::get_file_name(path), path, mode} {}
+
+inline ShaderProgram::~ShaderProgram() { release(); }
+
+inline void ShaderProgram::release() noexcept {
+    for (const auto& id : pending_shaders_) {
+        glDeleteShader(id);
+    }
+    pending_shaders_.clear();
+
+    glDeleteProgram(id_);
+    id_ = 0;
+}
+
+inline auto ShaderProgram::ready() -> bool {
+    if (status_ == ProgramStatus::compiling) {
+        int done{GL_TRUE};
+#ifdef GL_KHR_parallel_shader_compile
+        if (parallel_compile_supported()) {
+            glGetProgramiv(id_, GL_COMPLETION_STATUS_KHR, &done);
+        }
+#endif  // GL_KHR_parallel_shader_compile
+
+        if (done == GL_TRUE) {
+            finish();
+        }
+    }
+
+    return status_ == ProgramStatus::ready;
+}
+
+inline auto ShaderProgram::recompile(CompileMode mode) const -> ShaderProgram {
+    if (files_.empty()) {
+        return ShaderProgram{name_, shaders_, mode};
+    }
+
+    // files with a type hold one shader each, in the order of the shaders,
+    // whose format, entry point and constants are kept
+    std::vector<Shader> shaders;
+    for (std::size_t i = 0; i < files_.size(); ++i) {
+        const auto& [path, type] = files_[i];
+        std::string source = util::read_file(path);
+
+        if (type.has_value()) {
+            Shader shader = i < shaders_.size() ? shaders_[i] : Shader{};
+            shader.type = type.value();
+            shader.source = std::move(source);
+            shaders.push_back(std::move(shader));
+            continue;
+        }
+
+        for (auto& shader : parse_shaders(source)) {
+            shaders.push_back(std::move(shader));
+        }
+    }
+
+    ShaderProgram program{name_, std::move(shaders), mode};
+    program.files_ = files_;
+    return program;
+}
+
+inline auto ShaderProgram::replace(ShaderProgram&& program) -> bool {
+    if (!program.ready()) {
+        return false;
+    }
+
+    // the previous program object, pending or not, is released by `program`
+    std::swap(shaders_, program.shaders_);
+    std::swap(id_, program.id_);
+    std::swap(pending_shaders_, program.pending_shaders_);
+    std::swap(status_, program.status_);
+    std::swap(reflection_, program.reflection_);
+    std::swap(shadow_, program.shadow_);
+    uniform_cache_.clear();
+
+    restore_uniforms(program.reflection_, program.shadow_);
+
+    return true;
+}
+
+inline auto ShaderProgram::reload() -> bool { return replace(recompile()); }
+
+inline void ShaderProgram::set_compiler_threads(std::uint32_t count) noexcept {
+#ifdef GL_KHR_parallel_shader_compile
+    if (parallel_compile_supported()) {
+        glMaxShaderCompilerThreadsKHR(count);
+    }
+#else
+    static_cast<void>(count);
+#endif  // GL_KHR_parallel_shader_compile
+}
+
+inline auto ShaderProgram::parallel_compile_supported() noexcept -> bool {
+#ifdef GL_KHR_parallel_shader_compile
+    return GLAD_GL_KHR_parallel_shader_compile != 0;
+#else
+    return false;
+#endif  // GL_KHR_parallel_shader_compile
+}
+
+inline void ShaderProgram::bind() const { glUseProgram(id_); }
+
+inline void ShaderProgram::unbind() const { glUseProgram(0); }
 
 inline void ShaderProgram::dispatch(unsigned int x, unsigned int y,
                                     unsigned int z) const {
@@ -368,36 +1222,362 @@ inline void ShaderProgram::dispatch(unsigned int x, unsigned int y,
 }
 
 inline void ShaderProgram::set_uniform1i(std::string_view name, int val) {
-    glUniform1i(uniform_location(name), val);
+    upload_ints(uniform_location(name), {&val, 1});
 }
 
 inline void ShaderProgram::set_uniform1f(std::string_view name, float val) {
-    glUniform1f(uniform_location(name), val);
+    upload_floats(uniform_location(name), {&val, 1}, 1);
 }
 
 inline void ShaderProgram::set_uniform2f(std::string_view name, float val0,
                                          float val1) {
-    glUniform2f(uniform_location(name), val0, val1);
+    upload_floats(uniform_location(name), std::array{val0, val1}, 2);
 }
 
 inline void ShaderProgram::set_uniform3f(std::string_view name, float val0,
                                          float val1, float val2) {
-    glUniform3f(uniform_location(name), val0, val1, val2);
+    upload_floats(uniform_location(name), std::array{val0, val1, val2}, 3);
 }
 
 inline void ShaderProgram::set_uniform4f(std::string_view name, float val0,
                                          float val1, float val2, float val3) {
-    glUniform4f(uniform_location(name), val0, val1, val2, val3);
+    upload_floats(uniform_location(name),
+                  std::array{val0, val1, val2, val3}, 4);
 }
 
 inline void ShaderProgram::set_uniform_mat4f(std::string_view name,
-                                             std::span<float, 16> mat) {
-    glUniformMatrix4fv(uniform_location(name), 1, GL_FALSE, mat.data());
+                                             std::span<const float, 16> mat) {
+    upload_matrices(uniform_location(name), mat, 16);
 }
 
 inline void ShaderProgram::set_uniform_mat3f(std::string_view name,
-                                             std::span<float, 9> mat) {
-    glUniformMatrix3fv(uniform_location(name), 1, GL_FALSE, mat.data());
+                                             std::span<const float, 9> mat) {
+    upload_matrices(uniform_location(name), mat, 9);
+}
+
+inline void ShaderProgram::set(HashedUniform uniform, int val) {
+    upload_ints(uniform_location(uniform), {&val, 1});
+}
+
+inline void ShaderProgram::set(HashedUniform uniform, float val) {
+    upload_floats(uniform_location(uniform), {&val, 1}, 1);
+}
+
+inline void ShaderProgram::set(HashedUniform uniform,
+                               const std::array<float, 2>& val) {
+    upload_floats(uniform_location(uniform), val, 2);
+}
+
+inline void ShaderProgram::set(HashedUniform uniform,
+                               const std::array<float, 3>& val) {
+    upload_floats(uniform_location(uniform), val, 3);
+}
+
+inline void ShaderProgram::set(HashedUniform uniform,
+                               const std::array<float, 4>& val) {
+    upload_floats(uniform_location(uniform), val, 4);
+}
+
+inline void ShaderProgram::set(HashedUniform uniform,
+                               std::span<const float, 16> mat) {
+    upload_matrices(uniform_location(uniform), mat, 16);
+}
+
+inline void ShaderProgram::set(HashedUniform uniform,
+                               std::span<const float, 9> mat) {
+    upload_matrices(uniform_location(uniform), mat, 9);
+}
+
+inline void ShaderProgram::set_uniform1i(UniformHandle handle, int val) {
+    upload_ints(reflection_.location(handle), {&val, 1});
+}
+
+inline void ShaderProgram::set_uniform1f(UniformHandle handle, float val) {
+    upload_floats(reflection_.location(handle), {&val, 1}, 1);
+}
+
+inline void ShaderProgram::set_uniform2f(UniformHandle handle, float val0,
+                                         float val1) {
+    upload_floats(reflection_.location(handle), std::array{val0, val1}, 2);
+}
+
+inline void ShaderProgram::set_uniform3f(UniformHandle handle, float val0,
+                                         float val1, float val2) {
+    upload_floats(reflection_.location(handle),
+                  std::array{val0, val1, val2}, 3);
+}
+
+inline void ShaderProgram::set_uniform4f(UniformHandle handle, float val0,
+                                         float val1, float val2, float val3) {
+    upload_floats(reflection_.location(handle),
+                  std::array{val0, val1, val2, val3}, 4);
+}
+
+inline void ShaderProgram::set_uniform_mat4f(UniformHandle handle,
+                                             std::span<const float, 16> mat) {
+    upload_matrices(reflection_.location(handle), mat, 16);
+}
+
+inline void ShaderProgram::set_uniform_mat3f(UniformHandle handle,
+                                             std::span<const float, 9> mat) {
+    upload_matrices(reflection_.location(handle), mat, 9);
+}
+
+inline void ShaderProgram::set_uniform1iv(std::string_view name,
+                                          std::span<const int> vals) {
+    upload_ints(uniform_location(name), vals);
+}
+
+inline void ShaderProgram::set_uniform1fv(std::string_view name,
+                                          std::span<const float> vals) {
+    upload_floats(uniform_location(name), vals, 1);
+}
+
+inline void ShaderProgram::set_uniform2fv(
+    std::string_view name, std::span<const std::array<float, 2>> vals) {
+    upload_floats(uniform_location(name), flatten(vals), 2);
+}
+
+inline void ShaderProgram::set_uniform3fv(
+    std::string_view name, std::span<const std::array<float, 3>> vals) {
+    upload_floats(uniform_location(name), flatten(vals), 3);
+}
+
+inline void ShaderProgram::set_uniform4fv(
+    std::string_view name, std::span<const std::array<float, 4>> vals) {
+    upload_floats(uniform_location(name), flatten(vals), 4);
+}
+
+inline void ShaderProgram::set_uniform_mat4fv(
+    std::string_view name, std::span<const std::array<float, 16>> mats) {
+    upload_matrices(uniform_location(name), flatten(mats), 16);
+}
+
+inline void ShaderProgram::set_uniform_mat3fv(
+    std::string_view name, std::span<const std::array<float, 9>> mats) {
+    upload_matrices(uniform_location(name), flatten(mats), 9);
+}
+
+inline void ShaderProgram::set_array(HashedUniform uniform,
+                                     std::span<const int> vals) {
+    upload_ints(uniform_location(uniform), vals);
+}
+
+inline void ShaderProgram::set_array(HashedUniform uniform,
+                                     std::span<const float> vals) {
+    upload_floats(uniform_location(uniform), vals, 1);
+}
+
+inline void ShaderProgram::set_array(
+    HashedUniform uniform, std::span<const std::array<float, 2>> vals) {
+    upload_floats(uniform_location(uniform), flatten(vals), 2);
+}
+
+inline void ShaderProgram::set_array(
+    HashedUniform uniform, std::span<const std::array<float, 3>> vals) {
+    upload_floats(uniform_location(uniform), flatten(vals), 3);
+}
+
+inline void ShaderProgram::set_array(
+    HashedUniform uniform, std::span<const std::array<float, 4>> vals) {
+    upload_floats(uniform_location(uniform), flatten(vals), 4);
+}
+
+inline void ShaderProgram::set_array(
+    HashedUniform uniform, std::span<const std::array<float, 16>> mats) {
+    upload_matrices(uniform_location(uniform), flatten(mats), 16);
+}
+
+inline void ShaderProgram::set_array(
+    HashedUniform uniform, std::span<const std::array<float, 9>> mats) {
+    upload_matrices(uniform_location(uniform), flatten(mats), 9);
+}
+
+inline void ShaderProgram::set_uniform1iv(UniformHandle handle,
+                                          std::span<const int> vals) {
+    upload_ints(reflection_.location(handle), vals);
+}
+
+inline void ShaderProgram::set_uniform1fv(UniformHandle handle,
+                                          std::span<const float> vals) {
+    upload_floats(reflection_.location(handle), vals, 1);
+}
+
+inline void ShaderProgram::set_uniform2fv(
+    UniformHandle handle, std::span<const std::array<float, 2>> vals) {
+    upload_floats(reflection_.location(handle), flatten(vals), 2);
+}
+
+inline void ShaderProgram::set_uniform3fv(
+    UniformHandle handle, std::span<const std::array<float, 3>> vals) {
+    upload_floats(reflection_.location(handle), flatten(vals), 3);
+}
+
+inline void ShaderProgram::set_uniform4fv(
+    UniformHandle handle, std::span<const std::array<float, 4>> vals) {
+    upload_floats(reflection_.location(handle), flatten(vals), 4);
+}
+
+inline void ShaderProgram::set_uniform_mat4fv(
+    UniformHandle handle, std::span<const std::array<float, 16>> mats) {
+    upload_matrices(reflection_.location(handle), flatten(mats), 16);
+}
+
+inline void ShaderProgram::set_uniform_mat3fv(
+    UniformHandle handle, std::span<const std::array<float, 9>> mats) {
+    upload_matrices(reflection_.location(handle), flatten(mats), 9);
+}
+
+inline void ShaderProgram::upload_ints(int location,
+                                       std::span<const int> vals) {
+    if (!shadow_.update(location, std::as_bytes(vals))) {
+        return;
+    }
+
+    const auto count = static_cast<std::int32_t>(vals.size());
+    if (upload_ == UniformUpload::direct) {
+        glProgramUniform1iv(id_, location, count, vals.data());
+    } else {
+        glUniform1iv(location, count, vals.data());
+    }
+}
+
+inline void ShaderProgram::upload_floats(int location,
+                                         std::span<const float> vals,
+                                         std::size_t components) {
+    if (!shadow_.update(location, std::as_bytes(vals))) {
+        return;
+    }
+
+    const auto count = static_cast<std::int32_t>(vals.size() / components);
+    const bool direct = upload_ == UniformUpload::direct;
+    switch (components) {
+        case 1:
+            direct ? glProgramUniform1fv(id_, location, count, vals.data())
+                   : glUniform1fv(location, count, vals.data());
+            break;
+        case 2:
+            direct ? glProgramUniform2fv(id_, location, count, vals.data())
+                   : glUniform2fv(location, count, vals.data());
+            break;
+        case 3:
+            direct ? glProgramUniform3fv(id_, location, count, vals.data())
+                   : glUniform3fv(location, count, vals.data());
+            break;
+        default:
+            direct ? glProgramUniform4fv(id_, location, count, vals.data())
+                   : glUniform4fv(location, count, vals.data());
+            break;
+    }
+}
+
+inline void ShaderProgram::upload_matrices(int location,
+                                           std::span<const float> mats,
+                                           std::size_t size) {
+    if (!shadow_.update(location, std::as_bytes(mats))) {
+        return;
+    }
+
+    const auto count = static_cast<std::int32_t>(mats.size() / size);
+    const bool direct = upload_ == UniformUpload::direct;
+    if (size == 9) {
+        direct ? glProgramUniformMatrix3fv(id_, location, count, GL_FALSE,
+                                           mats.data())
+               : glUniformMatrix3fv(location, count, GL_FALSE, mats.data());
+    } else {
+        direct ? glProgramUniformMatrix4fv(id_, location, count, GL_FALSE,
+                                           mats.data())
+               : glUniformMatrix4fv(location, count, GL_FALSE, mats.data());
+    }
+}
+
+inline void ShaderProgram::restore_uniforms(const ProgramReflection& reflection,
+                                            const UniformShadow& shadow) {
+    // the program is not necessarily bound
+    const UniformUpload upload = std::exchange(upload_, UniformUpload::direct);
+
+    std::array<float, 16> floats{};
+    for (const auto& previous : reflection.uniforms()) {
+        const UniformInfo& current =
+            reflection_.info(reflection_.uniform(previous.name));
+        if (current.location < 0 || current.type != previous.type) {
+            continue;
+        }
+
+        const auto elements = std::min(previous.array_size, current.array_size);
+        for (std::int32_t i = 0; i < elements; ++i) {
+            const auto bytes = shadow.value(previous.location + i);
+            if (bytes.empty()) {
+                continue;
+            }
+
+            const std::int32_t location = current.location + i;
+            std::memcpy(floats.data(), bytes.data(),
+                        std::min(bytes.size(), sizeof(floats)));
+            const std::span<const float> vals{floats.data(),
+                                              bytes.size() / sizeof(float)};
+            switch (current.type) {
+                case GL_FLOAT:
+                case GL_FLOAT_VEC2:
+                case GL_FLOAT_VEC3:
+                case GL_FLOAT_VEC4:
+                    upload_floats(location, vals, vals.size());
+                    break;
+                case GL_FLOAT_MAT3:
+                case GL_FLOAT_MAT4:
+                    upload_matrices(location, vals, vals.size());
+                    break;
+                default:
+                    // ints, booleans, samplers and images
+                    if (bytes.size() == sizeof(int)) {
+                        int val{};
+                        std::memcpy(&val, bytes.data(), sizeof(val));
+                        upload_ints(location, {&val, 1});
+                    }
+                    break;
+            }
+        }
+    }
+
+    upload_ = upload;
+}
+
+template <std::size_t N>
+inline auto ShaderProgram::flatten(
+    std::span<const std::array<float, N>> vals) noexcept
+    -> std::span<const float> {
+    static_assert(sizeof(std::array<float, N>) == N * sizeof(float),
+                  "std::array<float, N> must not be padded");
+    return {reinterpret_cast<const float*>(vals.data()), vals.size() * N};
+}
+
+inline auto ShaderProgram::uniform(std::string_view name) const
+    -> UniformHandle {
+    const UniformHandle handle = reflection_.uniform(name);
+#ifdef RGL_DEBUG
+    if (!handle.valid()) {
+        std::fprintf(stderr,
+                     RGL_LINEINFO
+                     ", uniform \"%s\" not found in shader program \"%s\"\n",
+                     std::string{name}.data(), name_.data());
+    }
+#endif  // RGL_DEBUG
+    return handle;
+}
+
+inline void ShaderProgram::bind_uniform_block(UniformBlockHandle handle,
+                                              std::uint32_t binding) const {
+    if (reflection_.contains(handle)) {
+        glUniformBlockBinding(id_, reflection_.info(handle).index, binding);
+    }
+}
+
+inline void ShaderProgram::bind_storage_block(StorageBlockHandle handle,
+                                              std::uint32_t binding) const {
+    if (reflection_.contains(handle)) {
+        glShaderStorageBlockBinding(id_, reflection_.info(handle).index,
+                                    binding);
+    }
 }
 
 inline constexpr auto ShaderProgram::program_id() const -> std::uint32_t {
@@ -417,103 +1597,254 @@ inline auto ShaderProgram::operator[](std::size_t index) const
     return shaders_[index];
 }
 
-inline auto ShaderProgram::create_program() const -> std::uint32_t {
-    const std::uint32_t program{glCreateProgram()};
-    std::vector<std::uint32_t> shader_ids;
+inline void ShaderProgram::set_binary_cache(std::string_view directory) {
+    binary_cache_ = directory;
 
-    shader_ids.reserve(shaders_.size());
-    for (const auto& [type, src] : shaders_) {
-        shader_ids.push_back(compile(type, src));
+    if (!binary_cache_.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(binary_cache_, error);
     }
+}
+
+inline void ShaderProgram::create_program(CompileMode mode) {
+    id_ = glCreateProgram();
 
-    for (const auto& id : shader_ids) {
-        glAttachShader(program, id);
+    if (load_binary()) {
+        status_ = ProgramStatus::ready;
+        reflection_ = ProgramReflection{id_};
+        shadow_ = UniformShadow{reflection_};
+        return;
     }
-    glLinkProgram(program);
 
+    pending_shaders_.reserve(shaders_.size());
+    for (const auto& shader : shaders_) {
+        pending_shaders_.push_back(compile(shader));
+    }
+
+    for (const auto& id : pending_shaders_) {
+        glAttachShader(id_, id);
+    }
+    if (!binary_cache_.empty()) {
+        glProgramParameteri(id_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(id_);
+
+    status_ = ProgramStatus::compiling;
+    if (mode == CompileMode::sync) {
+        finish();
+    }
+}
+
+inline void ShaderProgram::finish() {
     int link_success = 0;
-    glGetProgramiv(program, GL_LINK_STATUS, &link_success);
+    glGetProgramiv(id_, GL_LINK_STATUS, &link_success);
 
     if (!link_success) [[unlikely]] {
 #ifdef RGL_DEBUG
+        for (std::size_t i = 0; i < pending_shaders_.size(); ++i) {
+            int comp_ok{};
+            glGetShaderiv(pending_shaders_[i], GL_COMPILE_STATUS, &comp_ok);
+            if (comp_ok == GL_TRUE) {
+                continue;
+            }
+
+            int max_length{};
+            glGetShaderiv(pending_shaders_[i], GL_INFO_LOG_LENGTH, &max_length);
+            std::string error_log(max_length, '\0');
+            glGetShaderInfoLog(pending_shaders_[i], max_length, &max_length,
+                               &error_log[0]);
+            std::string shader_type_str =
+                shader_type_to_string(shaders_[i].type);
+            std::fprintf(stderr,
+                         RGL_LINEINFO
+                         ", failed to compile %s shader of \"%s\": \n%s\n",
+                         shader_type_str.data(), name_.data(),
+                         error_log.data());
+        }
+
         int max_length{};
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &max_length);
+        glGetProgramiv(id_, GL_INFO_LOG_LENGTH, &max_length);
         std::vector<char> error_log(max_length);
-        glGetProgramInfoLog(program, max_length, &max_length, &error_log[0]);
-        std::fprintf(stderr,
-                     RGL_LINEINFO ", failed to link shader program: %s\n",
-                     error_log.data());
+        glGetProgramInfoLog(id_, max_length, &max_length, &error_log[0]);
+        std::fprintf(
+            stderr, RGL_LINEINFO ", failed to link shader program \"%s\": %s\n",
+            name_.data(), error_log.data());
 #endif  // RGL_DEBUG
-        glDeleteProgram(program);
-        return 0;
+        release();
+        status_ = ProgramStatus::failed;
+        return;
     }
 
     // Detach and delete shaders after linking the program.
-    for (const auto& id : shader_ids) {
-        glDetachShader(program, id);
+    for (const auto& id : pending_shaders_) {
+        glDetachShader(id_, id);
         glDeleteShader(id);
     }
+    pending_shaders_.clear();
 
-    glValidateProgram(program);
+    glValidateProgram(id_);
 
     int success = 0;
-    glGetProgramiv(program, GL_VALIDATE_STATUS, &success);
+    glGetProgramiv(id_, GL_VALIDATE_STATUS, &success);
     if (!success) [[unlikely]] {
 #ifdef RGL_DEBUG
         int max_length{};
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &max_length);
+        glGetProgramiv(id_, GL_INFO_LOG_LENGTH, &max_length);
         std::string error_log(max_length, '\0');
-        glGetProgramInfoLog(program, max_length, &max_length, &error_log[0]);
+        glGetProgramInfoLog(id_, max_length, &max_length, &error_log[0]);
         std::fprintf(stderr,
                      RGL_LINEINFO ", failed to validate shader program: %s\n",
                      error_log.data());
 #endif  // RGL_DEBUG
-        glDeleteProgram(program);
-        return 0;
+        release();
+        status_ = ProgramStatus::failed;
+        return;
     }
 
-    return program;
+    status_ = ProgramStatus::ready;
+    reflection_ = ProgramReflection{id_};
+    shadow_ = UniformShadow{reflection_};
+    store_binary();
 }
 
-inline auto ShaderProgram::compile(ShaderType shader_type,
-                                   std::string_view source) const
+inline auto ShaderProgram::load_binary() -> bool {
+    if (binary_cache_.empty()) {
+        return false;
+    }
+
+    // the binary format precedes the binary in the file
+    const std::filesystem::path path = binary_path();
+    const std::string binary = util::read_file(path.string());
+    if (binary.size() <= sizeof(std::uint32_t)) {
+        return false;
+    }
+
+    std::uint32_t format{};
+    std::memcpy(&format, binary.data(), sizeof(format));
+    glProgramBinary(id_, format, binary.data() + sizeof(format),
+                    static_cast<int>(binary.size() - sizeof(format)));
+
+    int success = 0;
+    glGetProgramiv(id_, GL_LINK_STATUS, &success);
+    if (!success) [[unlikely]] {
+#ifdef RGL_DEBUG
+        std::fprintf(stderr,
+                     RGL_LINEINFO
+                     ", cached binary of shader program \"%s\" rejected, "
+                     "compiling from source\n",
+                     name_.data());
+#endif  // RGL_DEBUG
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return false;
+    }
+
+    return true;
+}
+
+inline void ShaderProgram::store_binary() const {
+    if (binary_cache_.empty()) {
+        return;
+    }
+
+    int length{};
+    glGetProgramiv(id_, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::uint32_t format{};
+    std::string binary(sizeof(format) + length, '\0');
+    glGetProgramBinary(id_, length, &length, &format,
+                       binary.data() + sizeof(format));
+    std::memcpy(binary.data(), &format, sizeof(format));
+    binary.resize(sizeof(format) + length);
+
+    // write to a temporary file first, so that a concurrent run never reads a
+    // partial binary
+    const std::filesystem::path path = binary_path();
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+
+    std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+    out.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+    out.close();
+
+    std::error_code error;
+    if (out) {
+        std::filesystem::rename(temporary, path, error);
+    } else {
+        std::filesystem::remove(temporary, error);
+    }
+}
+
+inline auto ShaderProgram::binary_path() const -> std::filesystem::path {
+    std::uint64_t hash = util::fnv1a_basis;
+
+    for (const auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const auto* str = reinterpret_cast<const char*>(glGetString(name));
+        hash = util::fnv1a(str != nullptr ? str : "", hash);
+    }
+
+    // the lengths keep the sources of two shaders from hashing like their
+    // concatenation
+    for (const auto& shader : shaders_) {
+        hash = util::fnv1a(static_cast<std::uint32_t>(shader.type), hash);
+        hash = util::fnv1a(static_cast<std::uint32_t>(shader.format), hash);
+        hash = util::fnv1a(shader.source.size(), hash);
+        hash = util::fnv1a(shader.source, hash);
+
+        if (shader.format == ShaderFormat::spirv) {
+            hash = util::fnv1a(shader.entry_point.size(), hash);
+            hash = util::fnv1a(shader.entry_point, hash);
+            for (const auto& [id, value] : shader.constants) {
+                hash = util::fnv1a(id, hash);
+                hash = util::fnv1a(value, hash);
+            }
+        }
+    }
+
+    char file_name[21]{};
+    std::snprintf(file_name, sizeof(file_name), "%016llx.bin",
+                  static_cast<unsigned long long>(hash));
+    return binary_cache_ / file_name;
+}
+
+inline auto ShaderProgram::compile(const Shader& shader) const
     -> std::uint32_t {
-    const std::uint32_t id{glCreateShader(to_gl_type(shader_type))};
+    const std::uint32_t id{glCreateShader(to_gl_type(shader.type))};
+
+    if (shader.format == ShaderFormat::spirv) {
+        std::vector<std::uint32_t> indices(shader.constants.size());
+        std::vector<std::uint32_t> values(shader.constants.size());
+        std::ranges::transform(shader.constants, indices.begin(),
+                               &SpecializationConstant::id);
+        std::ranges::transform(shader.constants, values.begin(),
+                               &SpecializationConstant::value);
+
+        glShaderBinary(1, &id, GL_SHADER_BINARY_FORMAT_SPIR_V,
+                       shader.source.data(),
+                       static_cast<int>(shader.source.size()));
+        glSpecializeShader(id, shader.entry_point.data(),
+                           static_cast<std::uint32_t>(indices.size()),
+                           indices.data(), values.data());
+
+        return id;
+    }
 
     // taking a pointer to this temporary allows us to get its address, without
     // this intermediate variable we are forced to use the address of the
     // temporary, which is not allowed. if anyone knows a better way to do this,
     // please let me know.
-    const char* src{source.data()};
+    const char* src{shader.source.data()};
 
     glShaderSource(id, 1, &src, nullptr);
     glCompileShader(id);
 
-    int comp_ok{};
-    glGetShaderiv(id, GL_COMPILE_STATUS, &comp_ok);
-
-    if (comp_ok == GL_FALSE) [[unlikely]] {
-#ifdef RGL_DEBUG
-        int max_length{};
-        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &max_length);
-        std::string error_log(max_length, '\0');
-        glGetShaderInfoLog(id, max_length, &max_length, &error_log[0]);
-        int32_t type_id{};
-        glGetShaderiv(id, GL_SHADER_TYPE, &type_id);
-        std::string shader_type_str =
-            shader_type_to_string(static_cast<rgl::shader_type>(type_id));
-        std::fprintf(stderr,
-                     RGL_LINEINFO ", failed to compile %s shader: \n%s\n",
-                     shader_type_str.data(), error_log.data());
-#endif  // RGL_DEBUG
-        glDeleteShader(id);
-        return 0;
-    }
-
     return id;
 }
 
-inline auto ShaderProgram::parse_shaders(std::string_view source) const
+inline auto ShaderProgram::parse_shaders(std::string_view source)
     -> std::vector<Shader> {
     std::vector<Shader> shaders;
     std::string_view const type_token{"#type"};
@@ -549,23 +1880,26 @@ inline auto ShaderProgram::parse_shaders(std::string_view source) const
 }
 
 inline auto ShaderProgram::uniform_location(std::string_view name) -> int {
-    if (uniform_cache_.find(name) != uniform_cache_.end()) [[likely]] {
-        return uniform_cache_[name];
-    } else {
-        const int location{glGetUniformLocation(id_, name.data())};
+    return uniform_location(HashedUniform{name, util::fnv1a(name)});
+}
+
+inline auto ShaderProgram::uniform_location(HashedUniform uniform) -> int {
+    if (const auto* location = uniform_cache_.find(uniform)) [[likely]] {
+        return *location;
+    }
+
+    const int location{glGetUniformLocation(id_, uniform.name.data())};
 #ifdef RGL_DEBUG
-        if (location == -1) {
-            std::fprintf(
-                stderr,
-                RGL_LINEINFO
-                ", uniform \"%s\" not found in shader program \"%s\"\n",
-                name.data(), m_name.data());
-        }
+    if (location == -1) {
+        std::fprintf(stderr,
+                     RGL_LINEINFO
+                     ", uniform \"%s\" not found in shader program \"%s\"\n",
+                     uniform.name.data(), name_.data());
+    }
 #endif  // RGL_DEBUG
 
-        uniform_cache_[name] = location;
-        return location;
-    }
+    uniform_cache_.insert(uniform, location);
+    return location;
 }
 
 inline auto ShaderProgram::is_valid(std::uint32_t id) -> bool {
@@ -616,6 +1950,7 @@ inline constexpr auto ShaderProgram::to_gl_type(ShaderType shader_type)
         case ShaderType::tess_control: return GL_TESS_CONTROL_SHADER;
         case ShaderType::tess_eval: return GL_TESS_EVALUATION_SHADER;
         case ShaderType::geometry: return GL_GEOMETRY_SHADER;
+        case ShaderType::Compute: return GL_COMPUTE_SHADER;
         default:
 #ifdef RGL_DEBUG
             std::fprintf(stderr,
@@ -633,7 +1968,8 @@ inline auto ShaderProgram::string_to_shader_type(std::string_view str)
         {"fragment", ShaderType::fragment},
         {"tess_control", ShaderType::tess_control},
         {"tess_eval", ShaderType::tess_eval},
-        {"geometry", ShaderType::geometry}};
+        {"geometry", ShaderType::geometry},
+        {"compute", ShaderType::Compute}};
 
     if (map.find(str) != map.end()) [[likely]] {
         return map[str];
@@ -650,6 +1986,7 @@ std::string rgl::shader_type_to_string(ShaderType type) noexcept {
         case ShaderType::tess_control: return "tess_control";
         case ShaderType::tess_eval: return "tess_eval";
         case ShaderType::geometry: return "geometry";
+        case ShaderType::Compute: return "compute";
         default: return "unknown";
     }
 }
\ No newline at end of file
@@ -36,6 +36,18 @@ enum class ShaderArrayType : std::uint8_t {
  * type of the data that is passed as a uniform to the shader, as well as a
  * runtime type to feed as a parameter to other functions in this module.
  *
+ * Besides the float types, vertex attributes can use compact storage types:
+ * half floats, normalized 8 and 16 bit integers and packed 2_10_10_10 vectors,
+ * all read as floats by the shaders, as well as pure integer types, read as
+ * `int`/`uint` vectors.
+ *
+ * @note The float types must stay first and in this order, as
+ * rgl::shader_data_type::ShaderArrayType maps onto them.
+ *
+ * @warning OpenGL implementations expect attributes aligned to 4 bytes, which
+ * is why there are no 3 components half float and normalized types, prefer
+ * their 4 components variant.
+ *
  * @see rgl::shader_data_type::size
  * @see rgl::shader_data_type::to_opengl_type
  * @see rgl::shader_data_type::component_count
@@ -48,6 +60,31 @@ enum class U_Type : std::uint8_t {
     vec4,
     mat3,
     mat4,
+
+    // half floats
+    f16vec2,
+    f16vec4,
+
+    // normalized integers, [0, 1] for unorm and [-1, 1] for snorm
+    unorm8vec4,
+    snorm8vec4,
+    unorm16vec2,
+    unorm16vec4,
+    snorm16vec2,
+    snorm16vec4,
+    unorm2_10_10_10,
+    snorm2_10_10_10,
+
+    // pure integers
+    i32,
+    ivec2,
+    ivec3,
+    ivec4,
+    u32,
+    uvec2,
+    uvec3,
+    uvec4,
+    u8vec4,
 };
 
 /**
@@ -66,6 +103,25 @@ constexpr static auto size(U_Type type) -> std::size_t {
         case U_Type::mat3:  // internally padded to use 3 vec4s
             return size(U_Type::vec4) * 3;
         case U_Type::mat4: return size(U_Type::vec4) * 4;
+        case U_Type::f16vec2:
+        case U_Type::unorm8vec4:
+        case U_Type::snorm8vec4:
+        case U_Type::unorm16vec2:
+        case U_Type::snorm16vec2:
+        case U_Type::unorm2_10_10_10:
+        case U_Type::snorm2_10_10_10:
+        case U_Type::u8vec4: return sizeof(std::uint32_t);
+        case U_Type::f16vec4:
+        case U_Type::unorm16vec4:
+        case U_Type::snorm16vec4: return sizeof(std::uint16_t) * 4;
+        case U_Type::i32:
+        case U_Type::u32: return sizeof(std::int32_t);
+        case U_Type::ivec2:
+        case U_Type::uvec2: return sizeof(std::int32_t) * 2;
+        case U_Type::ivec3:
+        case U_Type::uvec3: return sizeof(std::int32_t) * 3;
+        case U_Type::ivec4:
+        case U_Type::uvec4: return sizeof(std::int32_t) * 4;
         default:
 #ifdef RGL_DEBUG
             std::fprintf(stderr, RGL_LINEINFO ", invalid shader enum %d\n",
@@ -90,6 +146,26 @@ constexpr static auto to_opengl_type(U_Type type) -> std::uint32_t {
         case U_Type::mat3: return GL_FLOAT_MAT3;
         case U_Type::mat4: return GL_FLOAT_MAT4;
         case U_Type::f32: return GL_FLOAT;
+        // compact storage types are read as floats by the shaders
+        case U_Type::f16vec2:
+        case U_Type::unorm16vec2:
+        case U_Type::snorm16vec2: return GL_FLOAT_VEC2;
+        case U_Type::f16vec4:
+        case U_Type::unorm8vec4:
+        case U_Type::snorm8vec4:
+        case U_Type::unorm16vec4:
+        case U_Type::snorm16vec4:
+        case U_Type::unorm2_10_10_10:
+        case U_Type::snorm2_10_10_10: return GL_FLOAT_VEC4;
+        case U_Type::i32: return GL_INT;
+        case U_Type::ivec2: return GL_INT_VEC2;
+        case U_Type::ivec3: return GL_INT_VEC3;
+        case U_Type::ivec4: return GL_INT_VEC4;
+        case U_Type::u32: return GL_UNSIGNED_INT;
+        case U_Type::uvec2: return GL_UNSIGNED_INT_VEC2;
+        case U_Type::uvec3: return GL_UNSIGNED_INT_VEC3;
+        case U_Type::uvec4:
+        case U_Type::u8vec4: return GL_UNSIGNED_INT_VEC4;
         default:
 
 #ifdef RGL_DEBUG
@@ -106,7 +182,9 @@ constexpr static auto to_opengl_type(U_Type type) -> std::uint32_t {
  *
  * @details This function retrieves the OpenGL type of the underlying type of
  * the shader data type. For scalar types, this is the same as to_opengl_type,
- * but for vector types, this is the type of the vector's components.
+ * but for vector types, this is the type of the vector's components. For
+ * compact storage types, this is the storage type of the components, as
+ * expected by the vertex attribute format functions.
  *
  * @param type
  * @return constexpr std::uint32_t
@@ -119,6 +197,25 @@ constexpr static auto to_opengl_underlying_type(U_Type type) -> std::uint32_t {
         case U_Type::mat3:
         case U_Type::mat4:
         case U_Type::f32: return GL_FLOAT;
+        case U_Type::f16vec2:
+        case U_Type::f16vec4: return GL_HALF_FLOAT;
+        case U_Type::unorm8vec4:
+        case U_Type::u8vec4: return GL_UNSIGNED_BYTE;
+        case U_Type::snorm8vec4: return GL_BYTE;
+        case U_Type::unorm16vec2:
+        case U_Type::unorm16vec4: return GL_UNSIGNED_SHORT;
+        case U_Type::snorm16vec2:
+        case U_Type::snorm16vec4: return GL_SHORT;
+        case U_Type::unorm2_10_10_10: return GL_UNSIGNED_INT_2_10_10_10_REV;
+        case U_Type::snorm2_10_10_10: return GL_INT_2_10_10_10_REV;
+        case U_Type::i32:
+        case U_Type::ivec2:
+        case U_Type::ivec3:
+        case U_Type::ivec4: return GL_INT;
+        case U_Type::u32:
+        case U_Type::uvec2:
+        case U_Type::uvec3:
+        case U_Type::uvec4: return GL_UNSIGNED_INT;
         default:
 #ifdef RGL_DEBUG
             std::fprintf(stderr, RGL_LINEINFO ", invalid shader enum %d\n",
@@ -145,6 +242,25 @@ constexpr static auto component_count(U_Type type) -> std::uint16_t {
         case U_Type::mat3: return 12;
         case U_Type::mat4: return 16;
         case U_Type::f32: return 1;
+        case U_Type::f16vec2:
+        case U_Type::unorm16vec2:
+        case U_Type::snorm16vec2: return 2;
+        case U_Type::f16vec4:
+        case U_Type::unorm8vec4:
+        case U_Type::snorm8vec4:
+        case U_Type::unorm16vec4:
+        case U_Type::snorm16vec4:
+        case U_Type::unorm2_10_10_10:
+        case U_Type::snorm2_10_10_10:
+        case U_Type::u8vec4: return 4;
+        case U_Type::i32:
+        case U_Type::u32: return 1;
+        case U_Type::ivec2:
+        case U_Type::uvec2: return 2;
+        case U_Type::ivec3:
+        case U_Type::uvec3: return 3;
+        case U_Type::ivec4:
+        case U_Type::uvec4: return 4;
         default:
 #ifdef RGL_DEBUG
             std::fprintf(stderr, RGL_LINEINFO ", invalid shader enum %d\n",
@@ -153,4 +269,50 @@ constexpr static auto component_count(U_Type type) -> std::uint16_t {
             std::terminate();
     }
 }
+
+/**
+ * @brief Check whether the shader data type is stored as normalized integers,
+ * which the shaders read as floats in [0, 1] (unsigned) or [-1, 1] (signed).
+ *
+ * @param type the type of the shader data.
+ * @return true if the type is normalized.
+ */
+constexpr static auto is_normalized(U_Type type) -> bool {
+    switch (type) {
+        case U_Type::unorm8vec4:
+        case U_Type::snorm8vec4:
+        case U_Type::unorm16vec2:
+        case U_Type::unorm16vec4:
+        case U_Type::snorm16vec2:
+        case U_Type::snorm16vec4:
+        case U_Type::unorm2_10_10_10:
+        case U_Type::snorm2_10_10_10: return true;
+        default: return false;
+    }
+}
+
+/**
+ * @brief Check whether the shader data type is a pure integer type, which the
+ * shaders read as `int` or `uint` vectors, without any conversion.
+ *
+ * @note Integer vertex attributes must be specified with the `I` variants of
+ * the vertex attribute format functions.
+ *
+ * @param type the type of the shader data.
+ * @return true if the type is a pure integer type.
+ */
+constexpr static auto is_integer(U_Type type) -> bool {
+    switch (type) {
+        case U_Type::i32:
+        case U_Type::ivec2:
+        case U_Type::ivec3:
+        case U_Type::ivec4:
+        case U_Type::u32:
+        case U_Type::uvec2:
+        case U_Type::uvec3:
+        case U_Type::uvec4:
+        case U_Type::u8vec4: return true;
+        default: return false;
+    }
+}
 };  // namespace rgl::shader_data_type
\ No newline at end of file
@@ -0,0 +1,290 @@
+#pragma once
+
+#include "shader.hpp"
+#include "shader_preprocessor.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace rgl {
+
+/**
+ * @brief A family of shader programs sharing their sources, compiled once per
+ * set of definitions, on demand.
+ *
+ * @details The sources go through a ShaderPreprocessor, which resolves their
+ * includes and injects the definitions of the permutation. Permutations are
+ * keyed by ShaderPreprocessor::permutation_key(), so the order definitions are
+ * given in does not matter, and are compiled the first time they are asked
+ * for. The definitions are compared on a key match, so that colliding keys
+ * yield distinct permutations.
+ *
+ * @code
+ * ShaderFamily lit{"lit", "shaders/lit.glsl"};
+ * const std::vector<ShaderDefine> defines{{"SHADOWS", "1"}, {"SKINNED", ""}};
+ * lit.get(defines).bind();
+ * @endcode
+ *
+ * @note Programs are kept at the same address for the lifetime of the family.
+ *
+ * @see rgl::ShaderPreprocessor
+ * @see rgl::ShaderWatcher
+ */
+class ShaderFamily {
+public:
+    /**
+     * @brief Construct a new shader family from a file holding several
+     * shaders, separated by the `#type` tag.
+     *
+     * @param name the name of the family, permutations are named after it.
+     * @param path the path of the file, relative to the current working
+     * directory, includes are resolved relatively to its directory.
+     * @param mode whether to wait for the permutations to be linked.
+     */
+    ShaderFamily(std::string_view name, std::string_view path,
+                 CompileMode mode = CompileMode::sync);
+
+    /**
+     * @brief Construct a new shader family from in-memory shaders.
+     *
+     * @note Includes are resolved relatively to the current working directory
+     * and to the include directories of the preprocessor.
+     *
+     * @param name the name of the family, permutations are named after it.
+     * @param shaders the shaders, with their sources.
+     * @param mode whether to wait for the permutations to be linked.
+     */
+    ShaderFamily(std::string_view name, std::vector<Shader> shaders,
+                 CompileMode mode = CompileMode::sync);
+
+    ShaderFamily(const ShaderFamily&) = delete;
+    auto operator=(const ShaderFamily&) -> ShaderFamily& = delete;
+
+    ShaderFamily(ShaderFamily&&) noexcept = default;
+    auto operator=(ShaderFamily&&) noexcept -> ShaderFamily& = default;
+
+    ~ShaderFamily() = default;
+
+    /**
+     * @brief Get the program of a permutation, compiling it if needed.
+     *
+     * @param defines the definitions of the permutation.
+     * @return ShaderProgram& the program of the permutation.
+     */
+    auto get(std::span<const ShaderDefine> defines = {}) -> ShaderProgram&;
+
+    /**
+     * @brief Read the sources again and compile every permutation again,
+     * permutations failing to compile or link keep their previous program
+     * object.
+     *
+     * @return std::size_t the number of permutations replaced.
+     */
+    auto reload() -> std::size_t;
+
+    /**
+     * @brief A permutation compiled again, to be given to the replace() of its
+     * program once ready.
+     *
+     */
+    struct Recompiled {
+        ShaderProgram* program;
+        ShaderProgram candidate;
+    };
+
+    /**
+     * @brief Compile every permutation again, leaving their programs
+     * untouched.
+     *
+     * @note The sources and the included files are not read again, unless
+     * they were invalidated.
+     *
+     * @param mode whether to wait for the new programs to be linked.
+     * @return std::vector<Recompiled> the new programs of the permutations.
+     */
+    [[nodiscard]] auto recompile(CompileMode mode = CompileMode::sync)
+        -> std::vector<Recompiled>;
+
+    /**
+     * @brief Drop a changed file, so that the next compilations read it again.
+     *
+     * @param path the file of the family or one of the files it includes.
+     */
+    void invalidate(std::string_view path);
+
+    /**
+     * @brief Get the file of the family, if any, followed by the files
+     * included so far by its permutations.
+     *
+     */
+    [[nodiscard]] auto files() const -> std::vector<std::string>;
+
+    /**
+     * @brief Get the number of permutations compiled.
+     *
+     */
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+        return permutations_.size();
+    }
+
+    /**
+     * @brief Get the preprocessor of the family, for instance to add include
+     * directories.
+     *
+     */
+    [[nodiscard]] auto preprocessor() noexcept -> ShaderPreprocessor& {
+        return preprocessor_;
+    }
+
+private:
+    struct Permutation {
+        std::vector<ShaderDefine> defines;
+        ShaderProgram program;
+    };
+
+    /**
+     * @brief Preprocess the sources and compile a permutation.
+     *
+     * @param defines the definitions of the permutation, sorted by name.
+     * @param mode whether to wait for the program to be linked.
+     */
+    auto build(std::span<const ShaderDefine> defines, CompileMode mode)
+        -> ShaderProgram;
+
+    std::string name_;
+    std::string path_;
+    std::vector<Shader> shaders_;
+    CompileMode mode_;
+
+    ShaderPreprocessor preprocessor_;
+    // keys may collide, permutations are told apart by their definitions
+    std::unordered_multimap<std::uint64_t, Permutation> permutations_;
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+inline ShaderFamily::ShaderFamily(std::string_view name, std::string_view path,
+                                  CompileMode mode)
+    : name_{name},
+      path_{path},
+      shaders_{ShaderProgram::parse_shaders(util::read_file(path))},
+      mode_{mode} {}
+
+inline ShaderFamily::ShaderFamily(std::string_view name,
+                                  std::vector<Shader> shaders,
+                                  CompileMode mode)
+    : name_{name}, shaders_{std::move(shaders)}, mode_{mode} {}
+
+inline auto ShaderFamily::get(std::span<const ShaderDefine> defines)
+    -> ShaderProgram& {
+    const std::uint64_t key = ShaderPreprocessor::permutation_key(defines);
+
+    // the stored definitions are sorted, the given ones in any order
+    const auto [first, last] = permutations_.equal_range(key);
+    const auto permutation = std::find_if(first, last, [&](const auto& entry) {
+        return std::ranges::is_permutation(entry.second.defines, defines);
+    });
+    if (permutation != last) {
+        return permutation->second.program;
+    }
+
+    std::vector<ShaderDefine> sorted = ShaderPreprocessor::sorted(defines);
+    ShaderProgram program = build(sorted, mode_);
+    return permutations_
+        .emplace(key, Permutation{std::move(sorted), std::move(program)})
+        ->second.program;
+}
+
+inline auto ShaderFamily::reload() -> std::size_t {
+    preprocessor_.clear();
+    if (!path_.empty()) {
+        shaders_ = ShaderProgram::parse_shaders(util::read_file(path_));
+    }
+
+    std::size_t replaced{};
+    for (auto& [program, candidate] : recompile(CompileMode::sync)) {
+        if (program->replace(std::move(candidate))) {
+            ++replaced;
+        }
+    }
+
+    return replaced;
+}
+
+inline auto ShaderFamily::recompile(CompileMode mode)
+    -> std::vector<Recompiled> {
+    std::vector<Recompiled> recompiled;
+    recompiled.reserve(permutations_.size());
+    for (auto& [key, permutation] : permutations_) {
+        recompiled.push_back(
+            {&permutation.program, build(permutation.defines, mode)});
+    }
+
+    return recompiled;
+}
+
+inline void ShaderFamily::invalidate(std::string_view path) {
+    preprocessor_.invalidate(path);
+
+    std::error_code error;
+    if (!path_.empty() && std::filesystem::equivalent(path, path_, error)) {
+        shaders_ = ShaderProgram::parse_shaders(util::read_file(path_));
+    }
+}
+
+inline auto ShaderFamily::files() const -> std::vector<std::string> {
+    std::vector<std::string> files;
+    if (!path_.empty()) {
+        files.push_back(path_);
+    }
+
+    const auto included = preprocessor_.included_files();
+    files.insert(files.end(), included.begin(), included.end());
+
+    return files;
+}
+
+inline auto ShaderFamily::build(std::span<const ShaderDefine> defines,
+                                CompileMode mode) -> ShaderProgram {
+    const std::string directory =
+        std::filesystem::path{path_}.parent_path().string();
+
+    // SPIR-V modules are already compiled, they are specialized instead
+    std::vector<Shader> shaders = shaders_;
+    for (auto& shader : shaders) {
+        if (shader.format == ShaderFormat::glsl) {
+            shader.source =
+                preprocessor_.process(shader.source, directory, defines);
+        }
+    }
+
+    // name the permutation after its definitions, e.g. lit[SHADOWS=1,SKINNED]
+    std::string name = name_;
+    if (!defines.empty()) {
+        name += '[';
+        for (const auto& [define, value] : defines) {
+            name += define;
+            if (!value.empty()) {
+                name += '=' + value;
+            }
+            name += ',';
+        }
+        name.back() = ']';
+    }
+
+    return ShaderProgram{name, std::move(shaders), mode};
+}
+
+}  // namespace rgl
@@ -0,0 +1,408 @@
+#pragma once
+
+#include "gl_functions.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace rgl {
+
+/**
+ * @brief A preprocessor definition injected in shader sources.
+ *
+ * @details Defined as `#define name value`, the value can be empty.
+ *
+ */
+struct ShaderDefine {
+    std::string name;
+    std::string value;
+
+    friend auto operator==(const ShaderDefine&, const ShaderDefine&)
+        -> bool = default;
+};
+
+/**
+ * @brief Preprocessor of GLSL sources, resolving includes and injecting
+ * definitions.
+ *
+ * @details
+ * - `#include "path"` and `#include <path>` lines are replaced by the
+ *   contents of the file, searched relatively to the including file first and
+ *   to the include directories then. Each file is included once per source,
+ *   as if it started with `#pragma once`, which also breaks include cycles.
+ *   A missing file is replaced by an `#error` directive, so that the
+ *   compilation fails with its name.
+ * - Definitions are injected after the `#version` directive, sorted by name,
+ *   so that the same set of definitions always yields the same source, and the
+ *   same entry of the program binary cache.
+ *
+ * Included files are read once and kept in a content cache, until invalidated.
+ * `#line` directives are emitted around included files, the source string
+ * numbers of the compilation errors map to the files with source_name().
+ *
+ * @code
+ * ShaderPreprocessor preprocessor;
+ * preprocessor.add_include_directory("shaders/include");
+ * const std::vector<ShaderDefine> defines{{"SHADOWS", "1"}};
+ * std::string source =
+ *     preprocessor.process(util::read_file("shaders/lit.frag"), "shaders",
+ *                          defines);
+ * @endcode
+ *
+ * @see rgl::ShaderFamily
+ */
+class ShaderPreprocessor {
+public:
+    /**
+     * @brief Add a directory to search included files in.
+     *
+     * @note Directories are searched in the order they are added, after the
+     * directory of the including file.
+     *
+     */
+    void add_include_directory(std::string_view directory);
+
+    /**
+     * @brief Resolve the includes of a source and inject definitions.
+     *
+     * @param source the GLSL source.
+     * @param directory the directory of the source, to resolve its includes
+     * relatively to.
+     * @param defines the definitions to inject.
+     * @return std::string the preprocessed source.
+     */
+    [[nodiscard]] auto process(std::string_view source,
+                               std::string_view directory,
+                               std::span<const ShaderDefine> defines = {})
+        -> std::string;
+
+    /**
+     * @brief Drop a file from the content cache, for instance after it
+     * changed.
+     *
+     */
+    void invalidate(std::string_view path);
+
+    /**
+     * @brief Drop every file from the content cache.
+     *
+     */
+    void clear() noexcept { cache_.clear(); }
+
+    /**
+     * @brief Get the path of the file of a source string number, as found in
+     * `#line` directives and compilation errors.
+     *
+     * @return std::string_view the path, empty for 0, the source given to
+     * process().
+     */
+    [[nodiscard]] auto source_name(std::size_t string_number) const
+        -> std::string_view;
+
+    /**
+     * @brief Get the files included so far, by every processed source, in the
+     * order of their source string numbers.
+     *
+     * @note The list only grows, it is not emptied by clear().
+     *
+     */
+    [[nodiscard]] auto included_files() const noexcept
+        -> std::span<const std::string> {
+        return names_;
+    }
+
+    /**
+     * @brief Sort definitions by name, the order they are injected in.
+     *
+     */
+    [[nodiscard]] static auto sorted(std::span<const ShaderDefine> defines)
+        -> std::vector<ShaderDefine>;
+
+    /**
+     * @brief Hash a set of definitions, regardless of their order.
+     *
+     * @return std::uint64_t the key of the permutation.
+     */
+    [[nodiscard]] static auto permutation_key(
+        std::span<const ShaderDefine> defines) -> std::uint64_t;
+
+private:
+    /**
+     * @brief Copy a source to the output, replacing its includes.
+     *
+     * @param source the source to copy.
+     * @param directory the directory of the source.
+     * @param string_number the source string number of the source.
+     * @param line the line number of the first line of the source.
+     * @param included the files already included.
+     * @param out the output.
+     */
+    void expand(std::string_view source,
+                const std::filesystem::path& directory,
+                std::size_t string_number, std::size_t line,
+                std::vector<std::filesystem::path>& included,
+                std::string& out);
+
+    /**
+     * @brief Find an included file.
+     *
+     * @return std::filesystem::path the path of the file, empty if not found.
+     */
+    [[nodiscard]] auto resolve(std::string_view name,
+                               const std::filesystem::path& directory) const
+        -> std::filesystem::path;
+
+    /**
+     * @brief Get the contents of a file, from the content cache.
+     *
+     */
+    auto load(const std::filesystem::path& path) -> const std::string&;
+
+    /**
+     * @brief Get the source string number of a file.
+     *
+     */
+    auto source_number(const std::filesystem::path& path) -> std::size_t;
+
+    /**
+     * @brief Get the file included by a line, if it is an include directive.
+     *
+     */
+    [[nodiscard]] static auto include_name(std::string_view line)
+        -> std::optional<std::string_view>;
+
+    std::vector<std::filesystem::path> include_directories_;
+    std::unordered_map<std::string, std::string> cache_;
+    // source string number - 1 to path, numbers stay stable across calls
+    std::vector<std::string> names_;
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+inline void ShaderPreprocessor::add_include_directory(
+    std::string_view directory) {
+    include_directories_.emplace_back(directory);
+}
+
+inline auto ShaderPreprocessor::process(std::string_view source,
+                                        std::string_view directory,
+                                        std::span<const ShaderDefine> defines)
+    -> std::string {
+    std::string out;
+    out.reserve(source.size());
+
+    // #version has to come first, the definitions follow it
+    std::size_t body{};
+    std::size_t line{1};
+    const std::size_t version = source.find("#version");
+    if (version != std::string_view::npos) {
+        const std::size_t eol = source.find('\n', version);
+        body = eol == std::string_view::npos ? source.size() : eol + 1;
+        line += std::ranges::count(source.substr(0, body), '\n');
+
+        out.append(source.substr(0, body));
+        if (out.back() != '\n') {
+            out += '\n';
+        }
+    }
+
+    if (!defines.empty()) {
+        for (const auto& [name, value] : sorted(defines)) {
+            out += "#define " + name + ' ' + value + '\n';
+        }
+        out += "#line " + std::to_string(line) + " 0\n";
+    }
+
+    std::vector<std::filesystem::path> included;
+    expand(source.substr(body), directory, 0, line, included, out);
+
+    return out;
+}
+
+inline void ShaderPreprocessor::invalidate(std::string_view path) {
+    std::error_code error;
+    const std::filesystem::path absolute =
+        std::filesystem::absolute(path, error);
+    cache_.erase(absolute.lexically_normal().string());
+}
+
+inline auto ShaderPreprocessor::source_name(std::size_t string_number) const
+    -> std::string_view {
+    if (string_number == 0 || string_number > names_.size()) {
+        return {};
+    }
+
+    return names_[string_number - 1];
+}
+
+inline auto ShaderPreprocessor::sorted(std::span<const ShaderDefine> defines)
+    -> std::vector<ShaderDefine> {
+    std::vector<ShaderDefine> result{defines.begin(), defines.end()};
+    std::ranges::stable_sort(result, {}, &ShaderDefine::name);
+    return result;
+}
+
+inline auto ShaderPreprocessor::permutation_key(
+    std::span<const ShaderDefine> defines) -> std::uint64_t {
+    std::uint64_t hash = util::fnv1a_basis;
+
+    // the lengths keep {"AB", ""} and {"A", "B"} apart
+    for (const auto& [name, value] : sorted(defines)) {
+        hash = util::fnv1a(name.size(), hash);
+        hash = util::fnv1a(name, hash);
+        hash = util::fnv1a(value.size(), hash);
+        hash = util::fnv1a(value, hash);
+    }
+
+    return hash;
+}
+
+inline void ShaderPreprocessor::expand(
+    std::string_view source, const std::filesystem::path& directory,
+    std::size_t string_number, std::size_t line,
+    std::vector<std::filesystem::path>& included, std::string& out) {
+    for (std::size_t pos{}; pos < source.size(); ++line) {
+        const std::size_t eol = source.find('\n', pos);
+        const std::size_t next =
+            eol == std::string_view::npos ? source.size() : eol + 1;
+        const std::string_view text = source.substr(pos, next - pos);
+        pos = next;
+
+        const auto name = include_name(text);
+        if (!name.has_value()) {
+            out.append(text);
+            continue;
+        }
+
+        const std::filesystem::path file = resolve(name.value(), directory);
+        if (file.empty()) [[unlikely]] {
+#ifdef RGL_DEBUG
+            std::fprintf(stderr, RGL_LINEINFO ", cannot find include \"%s\"\n",
+                         std::string{name.value()}.data());
+#endif  // RGL_DEBUG
+            out += "#error cannot find include \"";
+            out.append(name.value());
+            out += "\"\n";
+            continue;
+        }
+
+        // an empty line keeps the following lines numbered
+        if (std::ranges::find(included, file) != included.end()) {
+            out += '\n';
+            continue;
+        }
+        included.push_back(file);
+
+        const std::string& contents = load(file);
+        out += "#line 1 " + std::to_string(source_number(file)) + '\n';
+        expand(contents, file.parent_path(), source_number(file), 1,
+               included, out);
+        if (out.back() != '\n') {
+            out += '\n';
+        }
+        out += "#line " + std::to_string(line + 1) + ' ' +
+               std::to_string(string_number) + '\n';
+    }
+}
+
+inline auto ShaderPreprocessor::resolve(
+    std::string_view name, const std::filesystem::path& directory) const
+    -> std::filesystem::path {
+    const auto found =
+        [&](const std::filesystem::path& base) -> std::filesystem::path {
+        std::error_code error;
+        std::filesystem::path path = base / name;
+        if (!std::filesystem::is_regular_file(path, error)) {
+            return {};
+        }
+        return std::filesystem::absolute(path, error).lexically_normal();
+    };
+
+    if (auto path = found(directory); !path.empty()) {
+        return path;
+    }
+
+    for (const auto& include_directory : include_directories_) {
+        if (auto path = found(include_directory); !path.empty()) {
+            return path;
+        }
+    }
+
+    return {};
+}
+
+inline auto ShaderPreprocessor::load(const std::filesystem::path& path)
+    -> const std::string& {
+    const std::string key = path.string();
+
+    auto entry = cache_.find(key);
+    if (entry == cache_.end()) {
+        entry = cache_.emplace(key, util::read_file(key)).first;
+    }
+
+    return entry->second;
+}
+
+inline auto ShaderPreprocessor::source_number(
+    const std::filesystem::path& path) -> std::size_t {
+    const std::string name = path.string();
+
+    const auto it = std::ranges::find(names_, name);
+    if (it != names_.end()) {
+        return static_cast<std::size_t>(it - names_.begin()) + 1;
+    }
+
+    names_.push_back(name);
+    return names_.size();
+}
+
+inline auto ShaderPreprocessor::include_name(std::string_view line)
+    -> std::optional<std::string_view> {
+    const auto skip_blanks = [&] {
+        const std::size_t first = line.find_first_not_of(" \t");
+        line.remove_prefix(first == std::string_view::npos ? line.size()
+                                                           : first);
+    };
+
+    skip_blanks();
+    if (!line.starts_with('#')) {
+        return std::nullopt;
+    }
+    line.remove_prefix(1);
+
+    skip_blanks();
+    constexpr std::string_view directive{"include"};
+    if (!line.starts_with(directive)) {
+        return std::nullopt;
+    }
+    line.remove_prefix(directive.size());
+
+    skip_blanks();
+    if (line.empty() || (line.front() != '"' && line.front() != '<')) {
+        return std::nullopt;
+    }
+
+    const char close = line.front() == '"' ? '"' : '>';
+    const std::size_t end = line.find(close, 1);
+    if (end == std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    return line.substr(1, end - 1);
+}
+
+}  // namespace rgl
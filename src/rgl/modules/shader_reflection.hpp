@@ -0,0 +1,405 @@
+#pragma once
+
+#include "gl_functions.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace rgl {
+
+/**
+ * @brief Handle to an entry of a reflection table, resolved once from a name.
+ *
+ * @details The tag keeps handles of different tables apart, a uniform handle
+ * cannot be given where a block handle is expected.
+ *
+ * @note Handles are invalidated when the program object they were resolved
+ * from is replaced, for instance by a hot-reload. The generation of the
+ * reflection is stored in the handle, so a stale handle resolves to nothing
+ * instead of to another entry.
+ *
+ */
+template <typename Tag>
+struct ReflectionHandle {
+    std::int32_t index{-1};
+    std::uint32_t generation{0};
+
+    [[nodiscard]] constexpr auto valid() const noexcept -> bool {
+        return index >= 0;
+    }
+};
+
+using UniformHandle = ReflectionHandle<struct UniformTag>;
+using UniformBlockHandle = ReflectionHandle<struct UniformBlockTag>;
+using StorageBlockHandle = ReflectionHandle<struct StorageBlockTag>;
+
+/**
+ * @brief An active uniform of the default uniform block of a program.
+ *
+ * @details Arrays are named without their `[0]` suffix.
+ *
+ */
+struct UniformInfo {
+    std::string name;
+    std::int32_t location;
+    // GL type, e.g. GL_FLOAT_MAT4
+    std::uint32_t type;
+    std::int32_t array_size;
+    // size of an element, as uploaded by glUniform*
+    std::uint32_t size;
+};
+
+/**
+ * @brief Get the size of a uniform of a given type, as uploaded by glUniform*.
+ *
+ * @note Booleans, samplers and images are uploaded as integers.
+ *
+ * @param type the GL type of the uniform, e.g. GL_FLOAT_VEC3.
+ * @return std::uint32_t the size in bytes.
+ */
+constexpr auto uniform_type_size(std::uint32_t type) noexcept
+    -> std::uint32_t {
+    switch (type) {
+        case GL_FLOAT_VEC2:
+        case GL_INT_VEC2:
+        case GL_UNSIGNED_INT_VEC2:
+        case GL_BOOL_VEC2:
+        case GL_DOUBLE:
+            return 8;
+        case GL_FLOAT_VEC3:
+        case GL_INT_VEC3:
+        case GL_UNSIGNED_INT_VEC3:
+        case GL_BOOL_VEC3:
+            return 12;
+        case GL_FLOAT_VEC4:
+        case GL_INT_VEC4:
+        case GL_UNSIGNED_INT_VEC4:
+        case GL_BOOL_VEC4:
+        case GL_FLOAT_MAT2:
+        case GL_DOUBLE_VEC2:
+            return 16;
+        case GL_FLOAT_MAT2x3:
+        case GL_FLOAT_MAT3x2:
+        case GL_DOUBLE_VEC3:
+            return 24;
+        case GL_FLOAT_MAT2x4:
+        case GL_FLOAT_MAT4x2:
+        case GL_DOUBLE_VEC4:
+        case GL_DOUBLE_MAT2:
+            return 32;
+        case GL_FLOAT_MAT3:
+            return 36;
+        case GL_FLOAT_MAT3x4:
+        case GL_FLOAT_MAT4x3:
+        case GL_DOUBLE_MAT2x3:
+        case GL_DOUBLE_MAT3x2:
+            return 48;
+        case GL_FLOAT_MAT4:
+        case GL_DOUBLE_MAT2x4:
+        case GL_DOUBLE_MAT4x2:
+            return 64;
+        case GL_DOUBLE_MAT3:
+            return 72;
+        case GL_DOUBLE_MAT3x4:
+        case GL_DOUBLE_MAT4x3:
+            return 96;
+        case GL_DOUBLE_MAT4:
+            return 128;
+        default:
+            return 4;
+    }
+}
+
+/**
+ * @brief An active uniform block or shader storage block of a program.
+ *
+ */
+struct BlockInfo {
+    std::string name;
+    // index of the block in its program interface
+    std::uint32_t index;
+    std::int32_t binding;
+    std::int32_t data_size;
+};
+
+/**
+ * @brief Reflection of the active uniforms, uniform blocks and shader storage
+ * blocks of a linked program.
+ *
+ * @details The program interfaces are enumerated once, with
+ * glGetProgramInterfaceiv and glGetProgramResourceiv, into flat tables sorted
+ * by name. Names are resolved into handles with a binary search, and a handle
+ * then resolves to its entry with an array index.
+ *
+ * @code
+ * const UniformHandle model = program.reflection().uniform("u_model");
+ * // every draw
+ * program.set_uniform_mat4f(model, matrix);
+ * @endcode
+ *
+ * @see https://www.khronos.org/opengl/wiki/Program_Introspection
+ */
+class ProgramReflection {
+public:
+    ProgramReflection() = default;
+
+    /**
+     * @brief Reflect a linked program.
+     *
+     * @param program the id of the program.
+     */
+    explicit ProgramReflection(std::uint32_t program);
+
+    /**
+     * @brief Resolve the name of an active uniform.
+     *
+     * @return UniformHandle the handle, invalid if the uniform is not active.
+     */
+    [[nodiscard]] auto uniform(std::string_view name) const -> UniformHandle;
+
+    [[nodiscard]] auto uniform_block(std::string_view name) const
+        -> UniformBlockHandle;
+
+    [[nodiscard]] auto storage_block(std::string_view name) const
+        -> StorageBlockHandle;
+
+    /**
+     * @brief Check if a handle is valid and was resolved from this reflection.
+     *
+     */
+    template <typename Tag>
+    [[nodiscard]] constexpr auto contains(
+        ReflectionHandle<Tag> handle) const noexcept -> bool {
+        return handle.valid() && handle.generation == generation_;
+    }
+
+    /**
+     * @brief Get the location of a uniform.
+     *
+     * @return std::int32_t the location, -1 for an invalid or stale handle,
+     * which glUniform* ignores.
+     */
+    [[nodiscard]] auto location(UniformHandle handle) const noexcept
+        -> std::int32_t {
+        return contains(handle) ? uniforms_[handle.index].location : -1;
+    }
+
+    /**
+     * @brief Get the entry of a uniform.
+     *
+     * @return const UniformInfo& the entry, an empty one with location -1 for
+     * an invalid or stale handle.
+     */
+    [[nodiscard]] auto info(UniformHandle handle) const noexcept
+        -> const UniformInfo& {
+        static const UniformInfo none{{}, -1, 0, 0, 0};
+        return contains(handle) ? uniforms_[handle.index] : none;
+    }
+
+    /**
+     * @brief Get the entry of a block.
+     *
+     * @return const BlockInfo& the entry, an empty one with binding -1 for an
+     * invalid or stale handle.
+     */
+    [[nodiscard]] auto info(UniformBlockHandle handle) const noexcept
+        -> const BlockInfo& {
+        return contains(handle) ? uniform_blocks_[handle.index] : no_block();
+    }
+
+    [[nodiscard]] auto info(StorageBlockHandle handle) const noexcept
+        -> const BlockInfo& {
+        return contains(handle) ? storage_blocks_[handle.index] : no_block();
+    }
+
+    /**
+     * @brief Get the generation of the reflection, unique to each reflected
+     * program object, 0 for an empty reflection.
+     *
+     */
+    [[nodiscard]] constexpr auto generation() const noexcept -> std::uint32_t {
+        return generation_;
+    }
+
+    [[nodiscard]] auto uniforms() const noexcept
+        -> std::span<const UniformInfo> {
+        return uniforms_;
+    }
+
+    [[nodiscard]] auto uniform_blocks() const noexcept
+        -> std::span<const BlockInfo> {
+        return uniform_blocks_;
+    }
+
+    [[nodiscard]] auto storage_blocks() const noexcept
+        -> std::span<const BlockInfo> {
+        return storage_blocks_;
+    }
+
+private:
+    /**
+     * @brief Get the name of a resource of a program interface.
+     *
+     */
+    static auto resource_name(std::uint32_t program, std::uint32_t interface,
+                              std::uint32_t index, std::int32_t length)
+        -> std::string;
+
+    /**
+     * @brief Enumerate the blocks of a program interface.
+     *
+     * @param program the id of the program.
+     * @param interface GL_UNIFORM_BLOCK or GL_SHADER_STORAGE_BLOCK.
+     */
+    static auto reflect_blocks(std::uint32_t program, std::uint32_t interface)
+        -> std::vector<BlockInfo>;
+
+    /**
+     * @brief Binary search a table sorted by name.
+     *
+     * @return std::int32_t the index of the entry, -1 if not found.
+     */
+    template <typename T>
+    static auto find(std::span<const T> table, std::string_view name)
+        -> std::int32_t;
+
+    static auto no_block() noexcept -> const BlockInfo& {
+        static const BlockInfo none{{}, 0, -1, 0};
+        return none;
+    }
+
+    // source of the generations, shared by every reflection
+    static inline std::atomic<std::uint32_t> next_generation_{0};
+
+    std::uint32_t generation_{0};
+    std::vector<UniformInfo> uniforms_;
+    std::vector<BlockInfo> uniform_blocks_;
+    std::vector<BlockInfo> storage_blocks_;
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+inline ProgramReflection::ProgramReflection(std::uint32_t program)
+    : generation_{++next_generation_} {
+    int count{};
+    int max_length{};
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_MAX_NAME_LENGTH,
+                            &max_length);
+
+    constexpr std::array<std::uint32_t, 3> properties{
+        GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE};
+    std::array<int, properties.size()> values{};
+
+    uniforms_.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        glGetProgramResourceiv(program, GL_UNIFORM, i, properties.size(),
+                               properties.data(), values.size(), nullptr,
+                               values.data());
+
+        // members of blocks and atomic counters have no location
+        if (values[0] < 0) {
+            continue;
+        }
+
+        std::string name = resource_name(program, GL_UNIFORM, i, max_length);
+        if (name.ends_with("[0]")) {
+            name.resize(name.size() - 3);
+        }
+
+        const auto type = static_cast<std::uint32_t>(values[1]);
+        uniforms_.push_back({std::move(name), values[0], type, values[2],
+                             uniform_type_size(type)});
+    }
+    std::ranges::sort(uniforms_, {}, &UniformInfo::name);
+
+    uniform_blocks_ = reflect_blocks(program, GL_UNIFORM_BLOCK);
+    storage_blocks_ = reflect_blocks(program, GL_SHADER_STORAGE_BLOCK);
+}
+
+inline auto ProgramReflection::uniform(std::string_view name) const
+    -> UniformHandle {
+    if (name.ends_with("[0]")) {
+        name.remove_suffix(3);
+    }
+
+    return {find<UniformInfo>(uniforms_, name), generation_};
+}
+
+inline auto ProgramReflection::uniform_block(std::string_view name) const
+    -> UniformBlockHandle {
+    return {find<BlockInfo>(uniform_blocks_, name), generation_};
+}
+
+inline auto ProgramReflection::storage_block(std::string_view name) const
+    -> StorageBlockHandle {
+    return {find<BlockInfo>(storage_blocks_, name), generation_};
+}
+
+inline auto ProgramReflection::resource_name(std::uint32_t program,
+                                             std::uint32_t interface,
+                                             std::uint32_t index,
+                                             std::int32_t length)
+    -> std::string {
+    std::string name(length, '\0');
+    int written{};
+    glGetProgramResourceName(program, interface, index, length, &written,
+                             name.data());
+    name.resize(written);
+    return name;
+}
+
+inline auto ProgramReflection::reflect_blocks(std::uint32_t program,
+                                              std::uint32_t interface)
+    -> std::vector<BlockInfo> {
+    int count{};
+    int max_length{};
+    glGetProgramInterfaceiv(program, interface, GL_ACTIVE_RESOURCES, &count);
+    glGetProgramInterfaceiv(program, interface, GL_MAX_NAME_LENGTH,
+                            &max_length);
+
+    constexpr std::array<std::uint32_t, 2> properties{GL_BUFFER_BINDING,
+                                                      GL_BUFFER_DATA_SIZE};
+    std::array<int, properties.size()> values{};
+
+    std::vector<BlockInfo> blocks;
+    blocks.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        glGetProgramResourceiv(program, interface, i, properties.size(),
+                               properties.data(), values.size(), nullptr,
+                               values.data());
+        blocks.push_back(
+            {resource_name(program, interface, i, max_length),
+             static_cast<std::uint32_t>(i), values[0], values[1]});
+    }
+    std::ranges::sort(blocks, {}, &BlockInfo::name);
+
+    return blocks;
+}
+
+template <typename T>
+inline auto ProgramReflection::find(std::span<const T> table,
+                                    std::string_view name) -> std::int32_t {
+    const auto entry = std::ranges::lower_bound(
+        table, name, {}, [](const T& info) -> std::string_view {
+            return info.name;
+        });
+
+    if (entry == table.end() || entry->name != name) {
+        return -1;
+    }
+
+    return static_cast<std::int32_t>(entry - table.begin());
+}
+
+}  // namespace rgl
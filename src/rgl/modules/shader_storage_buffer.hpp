@@ -0,0 +1,214 @@
+#pragma once
+
+#include "gl_functions.hpp"
+#include "vertex_buffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace rgl {
+
+/**
+ * @brief Shader Storage Buffer Object (SSBO) wrapper.
+ *
+ * @details Shader storage buffers hold arbitrary data that shaders, most
+ * notably compute shaders, can both read and write. Unlike uniform buffers
+ * their size is only limited by GPU memory, and the last member of a block can
+ * be an unsized array.
+ *
+ * @warning The driver lays out the data according to the layout qualifier of
+ * the block, it is best to explicitly use std430 on every GLSL block that
+ * reads the buffer and to avoid vec3 members.
+ *
+ * @see https://www.khronos.org/opengl/wiki/Shader_Storage_Buffer_Object
+ */
+class ShaderStorageBuffer {
+public:
+    /**
+     * @brief Construct a new, uninitialized, shader storage buffer object
+     *
+     * @param size the size of the buffer, in bytes.
+     * @param hint the usage hint of the buffer.
+     */
+    ShaderStorageBuffer(
+        std::size_t size,
+        DriverDrawHint hint = DriverDrawHint::DYNAMIC_DRAW) noexcept;
+
+    /**
+     * @brief Construct a new shader storage buffer object
+     *
+     * @param contents the initial contents of the buffer.
+     * @param hint the usage hint of the buffer.
+     * @tparam T the type of the elements of the buffer.
+     */
+    template <PlainOldData T>
+    ShaderStorageBuffer(
+        std::span<const T> contents,
+        DriverDrawHint hint = DriverDrawHint::DYNAMIC_DRAW) noexcept;
+
+    ~ShaderStorageBuffer();
+
+    ShaderStorageBuffer(const ShaderStorageBuffer&) = delete;
+    auto operator=(const ShaderStorageBuffer&) -> ShaderStorageBuffer& = delete;
+
+    ShaderStorageBuffer(ShaderStorageBuffer&& other) noexcept;
+    auto operator=(ShaderStorageBuffer&& other) noexcept
+        -> ShaderStorageBuffer&;
+
+    /**
+     * @brief Bind the shader storage buffer object to GL_SHADER_STORAGE_BUFFER.
+     *
+     */
+    void bind() const;
+
+    /**
+     * @brief Unbind any shader storage buffer object.
+     *
+     */
+    static void unbind();
+
+    /**
+     * @brief Bind the shader storage buffer object to an indexed binding
+     * point, the one referenced by `layout(binding = N)` in GLSL.
+     *
+     * @param binding_point the index of the binding point.
+     */
+    void bind_base(std::uint32_t binding_point) const;
+
+    /**
+     * @brief Replace the contents of the buffer.
+     *
+     * @details The storage is only reallocated if the contents do not fit in
+     * the current size.
+     *
+     * @param contents the new contents of the buffer.
+     * @tparam T the type of the elements of the buffer.
+     */
+    template <PlainOldData T>
+    void set_data(std::span<const T> contents);
+
+    /**
+     * @brief Make sure the buffer can hold a number of bytes, without
+     * preserving its contents.
+     *
+     * @details Useful when the buffer is only written by the GPU.
+     *
+     * @param size the size, in bytes.
+     */
+    void reserve(std::size_t size);
+
+    // UTILITIES
+
+    [[nodiscard]] constexpr auto id() const noexcept -> std::uint32_t {
+        return id_;
+    }
+
+    /**
+     * @brief Get the size of the buffer, in bytes.
+     *
+     */
+    [[nodiscard]] constexpr auto size() const noexcept -> std::size_t {
+        return size_;
+    }
+
+private:
+    std::uint32_t id_{};
+    DriverDrawHint hint_{DriverDrawHint::DYNAMIC_DRAW};
+    std::size_t size_{};
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+inline ShaderStorageBuffer::ShaderStorageBuffer(std::size_t size,
+                                                DriverDrawHint hint) noexcept
+    : hint_{hint},
+      size_{size} {
+    glGenBuffers(1, &id_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, id_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<ptrdiff_t>(size_),
+                 nullptr, hint_);
+}
+
+template <PlainOldData T>
+ShaderStorageBuffer::ShaderStorageBuffer(std::span<const T> contents,
+                                         DriverDrawHint hint) noexcept
+    : hint_{hint},
+      size_{contents.size_bytes()} {
+    glGenBuffers(1, &id_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, id_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<ptrdiff_t>(size_),
+                 contents.data(), hint_);
+}
+
+inline ShaderStorageBuffer::~ShaderStorageBuffer() {
+    if (id_ != 0) {
+        glDeleteBuffers(1, &id_);
+    }
+}
+
+inline ShaderStorageBuffer::ShaderStorageBuffer(
+    ShaderStorageBuffer&& other) noexcept
+    : id_{other.id_},
+      hint_{other.hint_},
+      size_{other.size_} {
+    other.id_ = 0;
+}
+
+inline auto ShaderStorageBuffer::operator=(ShaderStorageBuffer&& other) noexcept
+    -> ShaderStorageBuffer& {
+    if (this != &other) {
+        glDeleteBuffers(1, &id_);
+        id_ = other.id_;
+        hint_ = other.hint_;
+        size_ = other.size_;
+
+        other.id_ = 0;
+    }
+
+    return *this;
+}
+
+inline void ShaderStorageBuffer::bind() const {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, id_);
+}
+
+inline void ShaderStorageBuffer::unbind() {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+inline void ShaderStorageBuffer::bind_base(std::uint32_t binding_point) const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding_point, id_);
+}
+
+template <PlainOldData T>
+void ShaderStorageBuffer::set_data(std::span<const T> contents) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, id_);
+
+    if (contents.size_bytes() > size_) {
+        size_ = contents.size_bytes();
+        glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<ptrdiff_t>(size_),
+                     contents.data(), hint_);
+    } else if (!contents.empty()) {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+                        static_cast<ptrdiff_t>(contents.size_bytes()),
+                        contents.data());
+    }
+}
+
+inline void ShaderStorageBuffer::reserve(std::size_t size) {
+    if (size <= size_) {
+        return;
+    }
+
+    size_ = size;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, id_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<ptrdiff_t>(size_),
+                 nullptr, hint_);
+}
+
+}  // namespace rgl
\ No newline at end of file
@@ -0,0 +1,427 @@
+#pragma once
+
+#include "shader.hpp"
+#include "shader_family.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <unordered_map>
+#endif  // __linux__
+
+namespace rgl {
+
+/**
+ * @brief Hot-reloader of shader programs.
+ *
+ * @details Watches the files of shader programs and, when one of them changes,
+ * compiles the program again in the background, with CompileMode::async. The
+ * program object of the watched program is replaced once the new one is
+ * linked, a new program failing to compile or link is dropped and the watched
+ * program keeps working with its previous program object.
+ *
+ * Changes are detected with inotify on Linux, by watching the directories of
+ * the files so that editors replacing files on save are handled, and by
+ * comparing the modification times and the sizes of the files elsewhere.
+ *
+ * Shader families are watched along with the files their permutations include,
+ * the files included by new permutations are picked up by the next poll.
+ *
+ * @code
+ * ShaderWatcher watcher;
+ * watcher.watch(program);
+ * // every frame
+ * watcher.poll();
+ * program.bind();
+ * @endcode
+ *
+ * @warning Watched programs and families are referenced, they must not be
+ * moved or destroyed before being unwatched.
+ *
+ * @see rgl::ShaderProgram::reload
+ */
+class ShaderWatcher {
+public:
+    ShaderWatcher() noexcept;
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    auto operator=(const ShaderWatcher&) -> ShaderWatcher& = delete;
+
+    ShaderWatcher(ShaderWatcher&& other) noexcept;
+    auto operator=(ShaderWatcher&& other) noexcept -> ShaderWatcher&;
+
+    ~ShaderWatcher();
+
+    /**
+     * @brief Watch the files of a program.
+     *
+     * @note Programs created from in-memory sources have no files to watch.
+     *
+     * @param program the program to reload when its files change.
+     */
+    void watch(ShaderProgram& program);
+
+    /**
+     * @brief Stop watching a program, dropping its pending reload.
+     *
+     */
+    void unwatch(const ShaderProgram& program);
+
+    /**
+     * @brief Watch the file of a family and the files its permutations
+     * include, every permutation being reloaded when one of them changes.
+     *
+     * @param family the family to reload when its files change.
+     */
+    void watch(ShaderFamily& family);
+
+    /**
+     * @brief Stop watching a family, dropping the pending reloads of its
+     * permutations.
+     *
+     */
+    void unwatch(const ShaderFamily& family);
+
+    /**
+     * @brief Start reloading the programs whose files changed, and replace the
+     * program objects of the reloaded programs that are ready.
+     *
+     * @note Never waits for the driver, to be called once per frame.
+     *
+     * @return std::size_t the number of programs replaced by this call.
+     */
+    auto poll() -> std::size_t;
+
+    /**
+     * @brief Get the number of watched programs and families.
+     *
+     */
+    [[nodiscard]] auto watched_count() const noexcept -> std::size_t {
+        return programs_.size() + families_.size();
+    }
+
+private:
+    struct WatchedFile {
+        std::filesystem::path path;
+        std::filesystem::file_time_type time;
+        std::uintmax_t size;
+    };
+
+    struct WatchedProgram {
+        ShaderProgram* program;
+        std::vector<WatchedFile> files;
+    };
+
+    struct WatchedFamily {
+        ShaderFamily* family;
+        std::vector<WatchedFile> files;
+    };
+
+    struct Reload {
+        ShaderProgram* program;
+        // the family of the program, if it is a permutation
+        const ShaderFamily* family;
+        ShaderProgram candidate;
+    };
+
+    /**
+     * @brief Start watching a file.
+     *
+     */
+    auto watch_file(std::string_view file) -> WatchedFile;
+
+    /**
+     * @brief Watch the files included by the permutations of the watched
+     * families since the last poll.
+     *
+     */
+    void watch_included_files();
+
+    /**
+     * @brief Replace the pending reload of a program, if any.
+     *
+     */
+    void start_reload(Reload reload);
+
+    /**
+     * @brief Collect the files that changed since the last poll.
+     *
+     */
+    [[nodiscard]] auto changed_files() -> std::vector<std::filesystem::path>;
+
+    static auto normalize(std::string_view path) -> std::filesystem::path;
+
+    std::vector<WatchedProgram> programs_;
+    std::vector<WatchedFamily> families_;
+    std::vector<Reload> reloads_;
+
+#ifdef __linux__
+    int fd_{-1};
+    // watched directories, by watch descriptor
+    std::unordered_map<int, std::filesystem::path> directories_;
+#endif  // __linux__
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+inline ShaderWatcher::ShaderWatcher() noexcept {
+#ifdef __linux__
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+#ifdef RGL_DEBUG
+    if (fd_ < 0) {
+        std::fprintf(stderr,
+                     RGL_LINEINFO ", failed to initialize inotify, shaders "
+                                  "will not be reloaded\n");
+    }
+#endif  // RGL_DEBUG
+#endif  // __linux__
+}
+
+inline ShaderWatcher::ShaderWatcher(ShaderWatcher&& other) noexcept
+    : programs_{std::move(other.programs_)},
+      families_{std::move(other.families_)},
+      reloads_{std::move(other.reloads_)} {
+#ifdef __linux__
+    fd_ = other.fd_;
+    directories_ = std::move(other.directories_);
+    other.fd_ = -1;
+#endif  // __linux__
+}
+
+inline auto ShaderWatcher::operator=(ShaderWatcher&& other) noexcept
+    -> ShaderWatcher& {
+    if (this != &other) {
+        programs_ = std::move(other.programs_);
+        families_ = std::move(other.families_);
+        reloads_ = std::move(other.reloads_);
+#ifdef __linux__
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        fd_ = other.fd_;
+        directories_ = std::move(other.directories_);
+        other.fd_ = -1;
+#endif  // __linux__
+    }
+    return *this;
+}
+
+inline ShaderWatcher::~ShaderWatcher() {
+#ifdef __linux__
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+#endif  // __linux__
+}
+
+inline void ShaderWatcher::watch(ShaderProgram& program) {
+    if (program.files().empty()) {
+        return;
+    }
+
+    unwatch(program);
+
+    WatchedProgram watched{&program, {}};
+    for (const auto& file : program.files()) {
+        watched.files.push_back(watch_file(file.path));
+    }
+
+    programs_.push_back(std::move(watched));
+}
+
+inline void ShaderWatcher::unwatch(const ShaderProgram& program) {
+    std::erase_if(programs_, [&](const WatchedProgram& watched) {
+        return watched.program == &program;
+    });
+    std::erase_if(reloads_, [&](const Reload& reload) {
+        return reload.program == &program;
+    });
+}
+
+inline void ShaderWatcher::watch(ShaderFamily& family) {
+    unwatch(family);
+
+    WatchedFamily watched{&family, {}};
+    for (const auto& file : family.files()) {
+        watched.files.push_back(watch_file(file));
+    }
+
+    families_.push_back(std::move(watched));
+}
+
+inline void ShaderWatcher::unwatch(const ShaderFamily& family) {
+    std::erase_if(families_, [&](const WatchedFamily& watched) {
+        return watched.family == &family;
+    });
+    std::erase_if(reloads_, [&](const Reload& reload) {
+        return reload.family == &family;
+    });
+}
+
+inline auto ShaderWatcher::poll() -> std::size_t {
+    watch_included_files();
+    const std::vector<std::filesystem::path> changed = changed_files();
+
+    const auto is_changed = [&](const WatchedFile& file) {
+        return std::ranges::find(changed, file.path) != changed.end();
+    };
+
+    for (const auto& watched : programs_) {
+        if (std::ranges::any_of(watched.files, is_changed)) {
+            start_reload({watched.program, nullptr,
+                          watched.program->recompile(CompileMode::async)});
+        }
+    }
+
+    for (const auto& watched : families_) {
+        bool dirty{false};
+        for (const auto& file : watched.files) {
+            if (is_changed(file)) {
+                watched.family->invalidate(file.path.string());
+                dirty = true;
+            }
+        }
+        if (!dirty) {
+            continue;
+        }
+
+        for (auto& [program, candidate] :
+             watched.family->recompile(CompileMode::async)) {
+            start_reload({program, watched.family, std::move(candidate)});
+        }
+    }
+
+    std::size_t replaced{};
+    std::erase_if(reloads_, [&](Reload& reload) {
+        if (!reload.candidate.ready()) {
+            return reload.candidate.status() == ProgramStatus::failed;
+        }
+
+        reload.program->replace(std::move(reload.candidate));
+        ++replaced;
+        return true;
+    });
+
+    return replaced;
+}
+
+inline auto ShaderWatcher::watch_file(std::string_view file) -> WatchedFile {
+    std::filesystem::path path = normalize(file);
+
+    std::error_code error;
+    const auto time = std::filesystem::last_write_time(path, error);
+    const auto size = std::filesystem::file_size(path, error);
+
+#ifdef __linux__
+    if (fd_ >= 0) {
+        // editors often save by replacing the file, which a watch on the file
+        // itself would not survive
+        const std::filesystem::path directory = path.parent_path();
+        const int wd = inotify_add_watch(fd_, directory.c_str(),
+                                         IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd >= 0) {
+            directories_[wd] = directory;
+        }
+    }
+#endif  // __linux__
+
+    return {std::move(path), time, size};
+}
+
+inline void ShaderWatcher::watch_included_files() {
+    for (auto& watched : families_) {
+        // the files of a family are only ever appended to
+        const std::vector<std::string> files = watched.family->files();
+        for (std::size_t i = watched.files.size(); i < files.size(); ++i) {
+            watched.files.push_back(watch_file(files[i]));
+        }
+    }
+}
+
+inline void ShaderWatcher::start_reload(Reload reload) {
+    // a newer change supersedes a reload still compiling
+    std::erase_if(reloads_, [&](const Reload& pending) {
+        return pending.program == reload.program;
+    });
+    reloads_.push_back(std::move(reload));
+}
+
+inline auto ShaderWatcher::changed_files()
+    -> std::vector<std::filesystem::path> {
+    std::vector<std::filesystem::path> changed;
+
+#ifdef __linux__
+    if (fd_ >= 0) {
+        alignas(inotify_event) char buffer[4096];
+
+        for (;;) {
+            const ssize_t size = read(fd_, buffer, sizeof(buffer));
+            if (size <= 0) {
+                break;
+            }
+
+            for (ssize_t offset = 0; offset < size;) {
+                const auto* event =
+                    reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += static_cast<ssize_t>(sizeof(inotify_event)) +
+                          static_cast<ssize_t>(event->len);
+
+                const auto directory = directories_.find(event->wd);
+                if (event->len == 0 || directory == directories_.end()) {
+                    continue;
+                }
+                changed.push_back(directory->second / event->name);
+            }
+        }
+
+        return changed;
+    }
+#endif  // __linux__
+
+    // the sizes catch changes within the resolution of the file times
+    const auto compare = [&](std::vector<WatchedFile>& files) {
+        for (auto& [path, time, size] : files) {
+            std::error_code error;
+            const auto last_write =
+                std::filesystem::last_write_time(path, error);
+            const auto last_size = std::filesystem::file_size(path, error);
+            if (!error && (last_write != time || last_size != size)) {
+                time = last_write;
+                size = last_size;
+                changed.push_back(path);
+            }
+        }
+    };
+    for (auto& watched : programs_) {
+        compare(watched.files);
+    }
+    for (auto& watched : families_) {
+        compare(watched.files);
+    }
+
+    return changed;
+}
+
+inline auto ShaderWatcher::normalize(std::string_view path)
+    -> std::filesystem::path {
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(path, error);
+    return error ? std::filesystem::path{path} : absolute.lexically_normal();
+}
+
+}  // namespace rgl
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rgl {
+
+/**
+ * @brief Contiguous container storing its first elements inline.
+ *
+ * @details Behaves like a minimal std::vector, but the first N elements live
+ * inside the container itself, so small collections, such as the handful of
+ * vertex buffers of a vertex array, cost no heap allocation and no pointer
+ * chasing. Past N elements, the storage moves to the heap and grows
+ * geometrically.
+ *
+ * @note The container is move-only, as are the GL wrappers it is meant to
+ * hold. Growing and moving invalidate pointers to the elements, refer to them
+ * by index instead.
+ *
+ * @tparam T the type of the elements, must be nothrow move constructible.
+ * @tparam N the number of elements stored inline.
+ */
+template <typename T, std::size_t N>
+class SmallVector {
+    static_assert(N > 0, "SmallVector needs at least one inline element");
+    static_assert(std::is_nothrow_move_constructible_v<T>,
+                  "SmallVector elements must be nothrow move constructible");
+
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() noexcept = default;
+    ~SmallVector();
+
+    SmallVector(const SmallVector&) = delete;
+    auto operator=(const SmallVector&) -> SmallVector& = delete;
+
+    SmallVector(SmallVector&& other) noexcept;
+    auto operator=(SmallVector&& other) noexcept -> SmallVector&;
+
+    /**
+     * @brief Construct an element in place at the end of the container.
+     *
+     * @return T& a reference to the new element.
+     */
+    template <typename... Args>
+    auto emplace_back(Args&&... args) -> T&;
+
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    void pop_back() noexcept { std::destroy_at(data_ + --size_); }
+
+    void clear() noexcept;
+
+    /**
+     * @brief Make sure the container can hold a number of elements without
+     * reallocating.
+     *
+     */
+    void reserve(std::size_t capacity);
+
+    // UTILITIES
+
+    [[nodiscard]] auto operator[](std::size_t i) noexcept -> T& {
+        return data_[i];
+    }
+    [[nodiscard]] auto operator[](std::size_t i) const noexcept -> const T& {
+        return data_[i];
+    }
+
+    [[nodiscard]] auto front() noexcept -> T& { return data_[0]; }
+    [[nodiscard]] auto front() const noexcept -> const T& { return data_[0]; }
+    [[nodiscard]] auto back() noexcept -> T& { return data_[size_ - 1]; }
+    [[nodiscard]] auto back() const noexcept -> const T& {
+        return data_[size_ - 1];
+    }
+
+    [[nodiscard]] auto data() noexcept -> T* { return data_; }
+    [[nodiscard]] auto data() const noexcept -> const T* { return data_; }
+
+    [[nodiscard]] auto begin() noexcept -> iterator { return data_; }
+    [[nodiscard]] auto begin() const noexcept -> const_iterator {
+        return data_;
+    }
+    [[nodiscard]] auto end() noexcept -> iterator { return data_ + size_; }
+    [[nodiscard]] auto end() const noexcept -> const_iterator {
+        return data_ + size_;
+    }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return size_; }
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t {
+        return capacity_;
+    }
+    [[nodiscard]] auto empty() const noexcept -> bool { return size_ == 0; }
+
+    /**
+     * @brief Check whether the elements are stored inline.
+     *
+     */
+    [[nodiscard]] auto is_inline() const noexcept -> bool {
+        return data_ == inline_data();
+    }
+
+private:
+    [[nodiscard]] auto inline_data() noexcept -> T* {
+        return std::launder(reinterpret_cast<T*>(  // NOLINT
+            inline_));
+    }
+    [[nodiscard]] auto inline_data() const noexcept -> const T* {
+        return std::launder(reinterpret_cast<const T*>(  // NOLINT
+            inline_));
+    }
+
+    /**
+     * @brief Move the elements to a heap storage of the given capacity.
+     *
+     */
+    void reallocate(std::size_t capacity);
+
+    /**
+     * @brief Destroy the elements and free the heap storage, if any, leaving
+     * the container empty and inline.
+     *
+     */
+    void reset() noexcept;
+
+    /**
+     * @brief Take the elements of another container, leaving it empty.
+     *
+     */
+    void steal(SmallVector& other) noexcept;
+
+private:
+    alignas(T) std::byte inline_[N * sizeof(T)];
+    T* data_{inline_data()};
+    std::size_t size_{};
+    std::size_t capacity_{N};
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+template <typename T, std::size_t N>
+SmallVector<T, N>::~SmallVector() {
+    reset();
+}
+
+template <typename T, std::size_t N>
+SmallVector<T, N>::SmallVector(SmallVector&& other) noexcept {
+    steal(other);
+}
+
+template <typename T, std::size_t N>
+auto SmallVector<T, N>::operator=(SmallVector&& other) noexcept
+    -> SmallVector& {
+    if (this != &other) {
+        reset();
+        steal(other);
+    }
+
+    return *this;
+}
+
+template <typename T, std::size_t N>
+template <typename... Args>
+auto SmallVector<T, N>::emplace_back(Args&&... args) -> T& {
+    if (size_ == capacity_) {
+        reallocate(capacity_ * 2);
+    }
+
+    T* element = std::construct_at(data_ + size_, std::forward<Args>(args)...);
+    ++size_;
+
+    return *element;
+}
+
+template <typename T, std::size_t N>
+void SmallVector<T, N>::clear() noexcept {
+    std::destroy(data_, data_ + size_);
+    size_ = 0;
+}
+
+template <typename T, std::size_t N>
+void SmallVector<T, N>::reserve(std::size_t capacity) {
+    if (capacity > capacity_) {
+        reallocate(capacity);
+    }
+}
+
+template <typename T, std::size_t N>
+void SmallVector<T, N>::reallocate(std::size_t capacity) {
+    std::allocator<T> allocator;
+    T* storage = allocator.allocate(capacity);
+
+    std::uninitialized_move(data_, data_ + size_, storage);
+    std::destroy(data_, data_ + size_);
+
+    if (!is_inline()) {
+        allocator.deallocate(data_, capacity_);
+    }
+
+    data_ = storage;
+    capacity_ = capacity;
+}
+
+template <typename T, std::size_t N>
+void SmallVector<T, N>::reset() noexcept {
+    clear();
+
+    if (!is_inline()) {
+        std::allocator<T>{}.deallocate(data_, capacity_);
+        data_ = inline_data();
+        capacity_ = N;
+    }
+}
+
+template <typename T, std::size_t N>
+void SmallVector<T, N>::steal(SmallVector& other) noexcept {
+    if (other.is_inline()) {
+        std::uninitialized_move(other.data_, other.data_ + other.size_,
+                                data_);
+        size_ = other.size_;
+        other.clear();
+        return;
+    }
+
+    // heap storage changes hands without touching the elements
+    data_ = other.data_;
+    size_ = other.size_;
+    capacity_ = other.capacity_;
+
+    other.data_ = other.inline_data();
+    other.size_ = 0;
+    other.capacity_ = N;
+}
+
+}  // namespace rgl
\ No newline at end of file
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "shader_reflection.hpp"
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace rgl {
+
+/**
+ * @brief Counters of the uniform uploads of a program.
+ *
+ */
+struct UniformStats {
+    // uploads which reached the driver
+    std::uint64_t issued;
+    // uploads skipped, the value being unchanged
+    std::uint64_t skipped;
+};
+
+/**
+ * @brief Shadow copy of the values of the uniforms of a program, to skip the
+ * uploads of unchanged values.
+ *
+ * @details The shadow is sized from the reflection of the program, with one
+ * slot per uniform location, array elements having consecutive locations and
+ * consecutive values. An upload is only issued when its bytes differ from the
+ * shadow, compared with memcmp, or when the uniform was never uploaded.
+ *
+ * Uniforms the reflection does not know of are always uploaded.
+ *
+ * @warning Uniforms uploaded without going through the shadow, with glUniform*
+ * directly, desynchronize it, see invalidate().
+ *
+ * @see rgl::ShaderProgram::uniform_stats
+ */
+class UniformShadow {
+public:
+    UniformShadow() = default;
+
+    /**
+     * @brief Construct a new uniform shadow for a program.
+     *
+     * @param reflection the reflection of the program.
+     */
+    explicit UniformShadow(const ProgramReflection& reflection);
+
+    /**
+     * @brief Record the upload of a value, and check whether it has to be
+     * issued.
+     *
+     * @param location the location of the uniform, or of the first element.
+     * @param bytes the uploaded value, or consecutive array elements.
+     * @return true if the value changed and has to be uploaded.
+     */
+    auto update(std::int32_t location, std::span<const std::byte> bytes)
+        -> bool;
+
+    template <typename T>
+        requires(!std::convertible_to<const T&, std::span<const std::byte>>)
+    auto update(std::int32_t location, const T& value) -> bool {
+        return update(location, std::as_bytes(std::span{&value, 1}));
+    }
+
+    /**
+     * @brief Get the last value uploaded to a location.
+     *
+     * @param location the location of the uniform, or of an array element.
+     * @return std::span<const std::byte> the value of the element, empty if
+     * the location is unknown or was never uploaded.
+     */
+    [[nodiscard]] auto value(std::int32_t location) const noexcept
+        -> std::span<const std::byte>;
+
+    /**
+     * @brief Forget every value, so that the next uploads are all issued.
+     *
+     */
+    void invalidate() noexcept;
+
+    [[nodiscard]] auto stats() const noexcept -> UniformStats {
+        return stats_;
+    }
+
+    void reset_stats() noexcept { stats_ = {}; }
+
+private:
+    struct Slot {
+        std::uint32_t offset;
+        // size of the element, 0 for locations without a uniform
+        std::uint32_t size;
+        // size from the element to the end of its array
+        std::uint32_t extent;
+        bool written;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<std::byte> values_;
+    UniformStats stats_{};
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+inline UniformShadow::UniformShadow(const ProgramReflection& reflection) {
+    std::size_t location_count{};
+    std::size_t value_size{};
+    for (const auto& uniform : reflection.uniforms()) {
+        location_count =
+            std::max<std::size_t>(location_count, uniform.location +
+                                                      uniform.array_size);
+        value_size += std::size_t{uniform.size} * uniform.array_size;
+    }
+
+    slots_.resize(location_count);
+    values_.resize(value_size);
+
+    std::uint32_t offset{};
+    for (const auto& uniform : reflection.uniforms()) {
+        const auto elements = static_cast<std::uint32_t>(uniform.array_size);
+        for (std::uint32_t i = 0; i < elements; ++i) {
+            slots_[uniform.location + i] = {offset, uniform.size,
+                                            (elements - i) * uniform.size,
+                                            false};
+            offset += uniform.size;
+        }
+    }
+}
+
+inline auto UniformShadow::update(std::int32_t location,
+                                  std::span<const std::byte> bytes) -> bool {
+    // glUniform* ignores location -1
+    if (location < 0) {
+        return false;
+    }
+
+    if (static_cast<std::size_t>(location) >= slots_.size() ||
+        slots_[location].size == 0 || bytes.size() > slots_[location].extent)
+        [[unlikely]] {
+        ++stats_.issued;
+        return true;
+    }
+
+    const Slot& first = slots_[location];
+    const std::size_t elements = (bytes.size() + first.size - 1) / first.size;
+    const auto slots =
+        std::span{slots_}.subspan(static_cast<std::size_t>(location), elements);
+    std::byte* shadow = values_.data() + first.offset;
+
+    const bool written = std::ranges::all_of(
+        slots, [](const Slot& slot) { return slot.written; });
+    if (written && std::memcmp(shadow, bytes.data(), bytes.size()) == 0) {
+        ++stats_.skipped;
+        return false;
+    }
+
+    std::memcpy(shadow, bytes.data(), bytes.size());
+    for (auto& slot : slots) {
+        slot.written = true;
+    }
+
+    ++stats_.issued;
+    return true;
+}
+
+inline auto UniformShadow::value(std::int32_t location) const noexcept
+    -> std::span<const std::byte> {
+    if (location < 0 || static_cast<std::size_t>(location) >= slots_.size() ||
+        !slots_[location].written) {
+        return {};
+    }
+
+    const Slot& slot = slots_[location];
+    return std::span{values_}.subspan(slot.offset, slot.size);
+}
+
+inline void UniformShadow::invalidate() noexcept {
+    for (auto& slot : slots_) {
+        slot.written = false;
+    }
+}
+
+}  // namespace rgl
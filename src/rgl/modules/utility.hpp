@@ -1,8 +1,12 @@
 #pragma once
 
+#include <concepts>
+#include <cstddef>
 #include <cstdint>
 #include <fstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 namespace rgl {
 /**
@@ -68,4 +72,96 @@ static auto get_file_name(std::string_view path) -> std::string {
     size_t const last_dot = basename.find_last_of(".");
     return std::string(basename.substr(0, last_dot));
 }
-}  // namespace rgl::util
\ No newline at end of file
+
+/**
+ * @brief Offset basis of the 64-bit FNV-1a hash, the hash of no bytes.
+ *
+ */
+inline constexpr std::uint64_t fnv1a_basis{14695981039346656037ULL};
+
+/**
+ * @brief Prime of the 64-bit FNV-1a hash.
+ *
+ */
+inline constexpr std::uint64_t fnv1a_prime{1099511628211ULL};
+
+/**
+ * @brief Hash a sequence of bytes with 64-bit FNV-1a.
+ *
+ * @details Several values can be hashed together by passing the hash of the
+ * previous ones as the starting hash.
+ *
+ * @param bytes the bytes to hash.
+ * @param hash the starting hash.
+ * @return std::uint64_t the hash of the bytes.
+ */
+constexpr auto fnv1a(std::string_view bytes,
+                     std::uint64_t hash = fnv1a_basis) noexcept
+    -> std::uint64_t {
+    for (char const byte : bytes) {
+        hash ^= static_cast<std::uint8_t>(byte);
+        hash *= fnv1a_prime;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Hash an integer with 64-bit FNV-1a.
+ *
+ * @details The bytes of the integer are hashed from the least significant to
+ * the most significant one, so the hash does not depend on the endianness of
+ * the platform.
+ *
+ * @param value the integer to hash.
+ * @param hash the starting hash.
+ * @return std::uint64_t the hash of the integer.
+ */
+template <std::integral T>
+constexpr auto fnv1a(T value, std::uint64_t hash = fnv1a_basis) noexcept
+    -> std::uint64_t {
+    auto const bits = static_cast<std::make_unsigned_t<T>>(value);
+
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        hash ^= static_cast<std::uint8_t>(bits >> (i * 8));
+        hash *= fnv1a_prime;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief A string literal usable as a template argument.
+ *
+ * @code
+ * template <util::FixedString Name>
+ * struct Named {};
+ * Named<"u_model"> named;
+ * @endcode
+ *
+ * @note The characters are null-terminated.
+ */
+template <std::size_t N>
+struct FixedString {
+    // implicit, so that literals convert to it
+    consteval FixedString(const char (&str)[N]) noexcept {
+        for (std::size_t i = 0; i < N; ++i) {
+            data[i] = str[i];
+        }
+    }
+
+    [[nodiscard]] constexpr auto view() const noexcept -> std::string_view {
+        return {data, N - 1};
+    }
+
+    char data[N]{};
+};
+
+/**
+ * @brief Hash a string literal with 64-bit FNV-1a, at compile time.
+ *
+ */
+consteval auto fnv1a_literal(std::string_view str) noexcept -> std::uint64_t {
+    return fnv1a(str);
+}
+}  // namespace rgl::util
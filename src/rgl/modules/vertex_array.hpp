@@ -1,13 +1,17 @@
 #pragma once
 
+#include "buffer_arena.hpp"
 #include "gl_functions.hpp"
 #include "index_buffer.hpp"
+#include "indirect_buffer.hpp"
+#include "small_vector.hpp"
 #include "vertex_buffer.hpp"
 #include "vertex_buffer_inst.hpp"
 
+#include <cstddef>
 #include <cstdint>
-#include <list>
 #include <optional>
+#include <span>
 
 namespace rgl {
 
@@ -21,6 +25,10 @@ namespace rgl {
  * Rendering using VAOs is advised as it simplifies the process of rendering
  * multiple objects with different vertex data and different rendering modes.
  *
+ * The vertex array is set up through direct state access: the vertex format
+ * of each attribute is specified once, separately from the buffer bindings it
+ * reads from, and no global binding is touched while building it.
+ *
  * @see
  * https://www.khronos.org/opengl/wiki/Vertex_Specification#Vertex_Array_Object
  * @see vertex_buffer.hpp
@@ -59,7 +67,11 @@ public:
           vertex_buffers_(std::move(other.vertex_buffers_)),
           instanced_vbo_(std::move(other.instanced_vbo_)),
           index_buffer_(std::move(other.index_buffer_)),
-          attrib_index_(other.attrib_index_) {
+          arena_index_type_(other.arena_index_type_),
+          attrib_index_(other.attrib_index_),
+          binding_count_(other.binding_count_),
+          instance_id_(other.instance_id_),
+          instance_offset_(other.instance_offset_) {
         other.id_ = 0;
     }
 
@@ -76,7 +88,11 @@ public:
             vertex_buffers_ = std::move(other.vertex_buffers_);
             instanced_vbo_ = std::move(other.instanced_vbo_);
             index_buffer_ = std::move(other.index_buffer_);
+            arena_index_type_ = other.arena_index_type_;
             attrib_index_ = other.attrib_index_;
+            binding_count_ = other.binding_count_;
+            instance_id_ = other.instance_id_;
+            instance_offset_ = other.instance_offset_;
 
             other.id_ = 0;
         }
@@ -84,14 +100,25 @@ public:
     }
 
     /**
-     * @brief Iterator type returned from add_vertex_buffer.
+     * @brief Number of vertex buffers stored without heap allocation.
+     *
+     */
+    static constexpr std::size_t inline_buffer_count = 4;
+
+    /**
+     * @brief Buffer binding index reserved for the instance buffer, vertex
+     * buffers use the binding indices below it.
      *
      */
-    using Iterator_T = std::list<VertexBuffer>::iterator;
+    static constexpr std::uint32_t instance_binding = 15;
 
     /**
      * @brief Bind the vertex array object.
      *
+     * @details If the instance buffer has been reallocated or has published a
+     * new region since the last bind (see rgl::InstanceStorage), the instance
+     * binding is re-pointed to it, the attribute formats are left untouched.
+     *
      */
     void bind() const;
 
@@ -105,13 +132,45 @@ public:
      * @brief Add a vertex buffer to the vertex array object.
      * @param vbo the vertex buffer object to add.
      *
-     * @return iterator_t an iterator to the newly added vertex buffer, it is
-     * guaranteed to be valid for the lifetime of the vertex array object,
-     * useful to keep track of the individual VBOs.
+     * @return std::size_t the index of the newly added vertex buffer in
+     * buffers_data(), which stays valid for the lifetime of the vertex array
+     * object, useful to keep track of the individual VBOs.
      *
      * @see vertex_buffer.hpp
      */
-    auto add_vertex_buffer(VertexBuffer&& vbo) -> VertexArray::Iterator_T;
+    auto add_vertex_buffer(VertexBuffer&& vbo) -> std::size_t;
+
+    /**
+     * @brief Specify the format of the next attributes, without attaching any
+     * buffer to them.
+     *
+     * @details Separating the format from the buffers allows a single vertex
+     * array to draw every vertex buffer sharing the layout, by swapping the
+     * buffer with set_vertex_buffer().
+     *
+     * @param layout the layout of the vertices.
+     * @return std::uint32_t the buffer binding index the attributes read from.
+     * @see rgl::VertexArrayCache
+     */
+    auto add_vertex_format(const VertexBufferLayout& layout) -> std::uint32_t;
+
+    /**
+     * @brief Point a buffer binding to a vertex buffer, without taking
+     * ownership of it.
+     *
+     * @param binding the buffer binding index, see add_vertex_format().
+     * @param vbo the vertex buffer, must match the format of the binding.
+     */
+    void set_vertex_buffer(std::uint32_t binding,
+                           const VertexBuffer& vbo) const;
+
+    /**
+     * @brief Point the element buffer binding to an index buffer, without
+     * taking ownership of it.
+     *
+     * @param ibo the index buffer.
+     */
+    void set_element_buffer(const IndexBuffer& ibo) const;
 
     /**
      * @brief Set the instance buffer object
@@ -135,6 +194,61 @@ public:
      */
     void set_index_buffer(IndexBuffer&& ibo);
 
+    /**
+     * @brief Source vertices and indices from a buffer arena.
+     *
+     * @details The arena is bound both as a vertex buffer, with the attributes
+     * described by the layout starting at the beginning of the arena, and as
+     * the index buffer. Every view of the arena sharing the layout can then be
+     * drawn with draw_elements() without binding another vertex array.
+     *
+     * @warning The vertex array does not own the arena, which must outlive it.
+     *
+     * @param arena the arena holding the vertices and indices.
+     * @param layout the layout shared by the vertex views of the arena.
+     * @param index_type the type shared by the index views of the arena, used
+     * by draw_indirect().
+     * @see rgl::BufferArena
+     */
+    void set_arena(const BufferArena& arena, const VertexBufferLayout& layout,
+                   IndexType index_type = UNSIGNED_INT);
+
+    /**
+     * @brief Draw a mesh whose vertices and indices are views into the arena
+     * of the vertex array, using a base-vertex draw.
+     *
+     * @note Binds the vertex array object.
+     *
+     * @param indices the indices of the mesh.
+     * @param vertices the vertices of the mesh.
+     * @param mode the primitive type, defaults to GL_TRIANGLES.
+     * @see set_arena
+     */
+    void draw_elements(const IndexBuffer& indices, const VertexBuffer& vertices,
+                       std::uint32_t mode = GL_TRIANGLES) const;
+
+    /**
+     * @brief Issue indexed draws whose parameters are read from an indirect
+     * buffer.
+     *
+     * @details The commands can be written by the GPU, for instance by a
+     * culling compute pass, in which case the draw does not need any readback
+     * of the number of visible instances.
+     *
+     * @note Binds the vertex array object and the indirect buffer. The type
+     * of the indices is the one of the index buffer of the vertex array, or
+     * the one given to set_arena() if it has none.
+     *
+     * @param commands the indirect buffer holding the draw commands.
+     * @param first the index of the first command to draw.
+     * @param count the number of commands to draw.
+     * @param mode the primitive type, defaults to GL_TRIANGLES.
+     * @see rgl::IndirectBuffer
+     */
+    void draw_indirect(const IndirectBuffer& commands, std::size_t first = 0,
+                       std::size_t count = 1,
+                       std::uint32_t mode = GL_TRIANGLES) const;
+
     // utility functions
 
     /** @brief Get the vertex array object id.
@@ -144,13 +258,13 @@ public:
     [[nodiscard]] constexpr auto id() const -> uint32_t { return id_; }
 
     /**
-     * @brief Get the vertex buffer object at the specified index.
+     * @brief Get the vertex buffer objects, in the order they were added.
      *
-     * @return std::list<vertex_buffer>&  the vertex buffer object at the
-     * specified index.
+     * @return std::span<VertexBuffer> the vertex buffer objects, contiguous in
+     * memory.
      */
-    [[nodiscard]] constexpr auto buffers_data() -> std::list<VertexBuffer>& {
-        return vertex_buffers_;
+    [[nodiscard]] auto buffers_data() noexcept -> std::span<VertexBuffer> {
+        return {vertex_buffers_.data(), vertex_buffers_.size()};
     }
 
     /**
@@ -172,13 +286,46 @@ public:
         return index_buffer_;
     }
 
+private:
+    /**
+     * @brief Get the type of the indices the vertex array draws from.
+     *
+     */
+    [[nodiscard]] constexpr auto index_type() const noexcept -> IndexType {
+        return index_buffer_.id() != 0 ? index_buffer_.type()
+                                       : arena_index_type_;
+    }
+
+    /**
+     * @brief Point the instance binding to the current storage of the
+     * instance buffer.
+     *
+     */
+    void attach_instance_buffer() const;
+
+    /**
+     * @brief Enable the next attributes, specify their format and make them
+     * read from a buffer binding.
+     *
+     * @param layout the layout of the vertices.
+     * @param binding the buffer binding index the attributes read from.
+     */
+    void add_attributes(const VertexBufferLayout& layout,
+                        std::uint32_t binding);
+
 private:
     std::uint32_t id_{};
-    std::list<VertexBuffer> vertex_buffers_;
+    SmallVector<VertexBuffer, inline_buffer_count> vertex_buffers_;
     std::optional<VertexBufferInst> instanced_vbo_;
     IndexBuffer index_buffer_;
+    IndexType arena_index_type_{UNSIGNED_INT};
 
     uint32_t attrib_index_{};
+    uint32_t binding_count_{};
+
+    // the instance buffer storage the instanced attributes point to
+    mutable std::uint32_t instance_id_{};
+    mutable std::size_t instance_offset_{};
 };
 
 /*
@@ -187,66 +334,129 @@ private:
 
 */
 
-inline VertexArray::VertexArray() noexcept { glGenVertexArrays(1, &id_); }
+inline VertexArray::VertexArray() noexcept { glCreateVertexArrays(1, &id_); }
 
 inline VertexArray::~VertexArray() { glDeleteVertexArrays(1, &id_); }
 
-inline void VertexArray::bind() const { glBindVertexArray(id_); }
+inline void VertexArray::bind() const {
+    glBindVertexArray(id_);
+
+    if (instanced_vbo_.has_value() &&
+        (instanced_vbo_->id() != instance_id_ ||
+         instanced_vbo_->offset() != instance_offset_)) [[unlikely]] {
+        attach_instance_buffer();
+    }
+}
 
 inline void VertexArray::unbind() { glBindVertexArray(0); }
 
-inline auto VertexArray::add_vertex_buffer(VertexBuffer&& vbo)
-    -> VertexArray::Iterator_T {
-    vertex_buffers_.push_back(std::move(vbo));
-    glBindVertexArray(id_);
+inline auto VertexArray::add_vertex_buffer(VertexBuffer&& vbo) -> std::size_t {
+    VertexBuffer const& vbo_ref = vertex_buffers_.emplace_back(std::move(vbo));
+    set_vertex_buffer(add_vertex_format(vbo_ref.layout()), vbo_ref);
+
+    return vertex_buffers_.size() - 1;
+}
+
+inline auto VertexArray::add_vertex_format(const VertexBufferLayout& layout)
+    -> std::uint32_t {
+    std::uint32_t const binding = binding_count_++;
+    add_attributes(layout, binding);
+
+    return binding;
+}
 
-    // get a reference to the newly added vertex buffer from the variant in the
-    // vector
-    VertexBuffer const& vbo_ref = vertex_buffers_.back();
+inline void VertexArray::set_vertex_buffer(std::uint32_t binding,
+                                           const VertexBuffer& vbo) const {
+    glVertexArrayVertexBuffer(id_, binding, vbo.id(),
+                              static_cast<ptrdiff_t>(vbo.offset()),
+                              static_cast<int32_t>(vbo.layout().stride()));
+}
 
-    vbo_ref.bind();
+inline void VertexArray::set_element_buffer(const IndexBuffer& ibo) const {
+    glVertexArrayElementBuffer(id_, ibo.id());
+}
 
+inline void VertexArray::add_attributes(const VertexBufferLayout& layout,
+                                        std::uint32_t binding) {
     for (const auto& [type, name, offset, element_count] :
-         vbo_ref.layout().get_attributes()) {
-        glEnableVertexAttribArray(attrib_index_);
-        glVertexAttribPointer(
-            attrib_index_++,
-            static_cast<int32_t>(shader_data_type::component_count(type) *
-                                 element_count),
-            shader_data_type::to_opengl_underlying_type(type), GL_FALSE,
-            static_cast<int32_t>(vbo_ref.layout().stride()),
-            reinterpret_cast<const void*>(
-                offset));  // NOLINT (reinterpret-cast)
+         layout.get_attributes()) {
+        auto const components = static_cast<int32_t>(
+            shader_data_type::component_count(type) * element_count);
+        auto const gl_type = shader_data_type::to_opengl_underlying_type(type);
+
+        glEnableVertexArrayAttrib(id_, attrib_index_);
+        if (shader_data_type::is_integer(type)) {
+            // integers are not converted to floats
+            glVertexArrayAttribIFormat(id_, attrib_index_, components, gl_type,
+                                       offset);
+        } else {
+            glVertexArrayAttribFormat(
+                id_, attrib_index_, components, gl_type,
+                shader_data_type::is_normalized(type) ? GL_TRUE : GL_FALSE,
+                offset);
+        }
+        glVertexArrayAttribBinding(id_, attrib_index_++, binding);
     }
-
-    return std::prev(vertex_buffers_.end());
 }
 
 inline void VertexArray::set_instance_buffer(VertexBufferInst&& vbo) {
     instanced_vbo_ = std::move(vbo);
 
-    glBindVertexArray(id_);
-    instanced_vbo_->bind();
+    add_attributes(instanced_vbo_->layout(), instance_binding);
+    glVertexArrayBindingDivisor(id_, instance_binding, 1);
 
-    for (const auto& [type, name, offset, element_count] :
-         instanced_vbo_->layout().get_attributes()) {
-        glEnableVertexAttribArray(attrib_index_);
-        glVertexAttribPointer(
-            attrib_index_++,
-            static_cast<int32_t>(shader_data_type::component_count(type) *
-                                 element_count),
-            shader_data_type::to_opengl_underlying_type(type), GL_FALSE,
-            static_cast<int32_t>(instanced_vbo_->layout().stride()),
-            reinterpret_cast<const void*>(
-                offset));  // NOLINT (reinterpret-cast)
-        glVertexAttribDivisor(attrib_index_ - 1, 1);
-    }
+    attach_instance_buffer();
+}
+
+inline void VertexArray::attach_instance_buffer() const {
+    instance_id_ = instanced_vbo_->id();
+    instance_offset_ = instanced_vbo_->offset();
+
+    glVertexArrayVertexBuffer(
+        id_, instance_binding, instance_id_,
+        static_cast<ptrdiff_t>(instance_offset_),
+        static_cast<int32_t>(instanced_vbo_->layout().stride()));
 }
 
 inline void VertexArray::set_index_buffer(IndexBuffer&& ibo) {
     index_buffer_ = std::move(ibo);
 
-    glBindVertexArray(id_);
-    index_buffer_.bind();
+    set_element_buffer(index_buffer_);
+}
+
+inline void VertexArray::set_arena(const BufferArena& arena,
+                                   const VertexBufferLayout& layout,
+                                   IndexType index_type) {
+    arena_index_type_ = index_type;
+
+    glVertexArrayVertexBuffer(id_, add_vertex_format(layout), arena.id(), 0,
+                              static_cast<int32_t>(layout.stride()));
+
+    glVertexArrayElementBuffer(id_, arena.id());
+}
+
+inline void VertexArray::draw_elements(const IndexBuffer& indices,
+                                       const VertexBuffer& vertices,
+                                       std::uint32_t mode) const {
+    bind();
+
+    glDrawElementsBaseVertex(
+        mode, indices.count(), indices.type(),
+        reinterpret_cast<const void*>(  // NOLINT (reinterpret-cast)
+            indices.offset()),
+        vertices.base_vertex());
+}
+
+inline void VertexArray::draw_indirect(const IndirectBuffer& commands,
+                                       std::size_t first, std::size_t count,
+                                       std::uint32_t mode) const {
+    bind();
+    commands.bind();
+
+    glMultiDrawElementsIndirect(
+        mode, index_type(),
+        reinterpret_cast<const void*>(  // NOLINT (reinterpret-cast)
+            first * sizeof(DrawElementsIndirectCommand)),
+        static_cast<std::int32_t>(count), 0);
 }
 }  // namespace rgl
\ No newline at end of file
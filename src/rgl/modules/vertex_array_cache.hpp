@@ -0,0 +1,129 @@
+#pragma once
+
+#include "gl_functions.hpp"
+#include "index_buffer.hpp"
+#include "vertex_array.hpp"
+#include "vertex_buffer.hpp"
+#include "vertex_buffer_layout.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace rgl {
+
+/**
+ * @brief Cache of vertex arrays keyed by vertex format.
+ *
+ * @details Meshes sharing the same vertex buffer layout do not need a vertex
+ * array each: the attribute formats of a vertex array only depend on the
+ * layout, the buffers being separate bindings. The cache holds a single
+ * vertex array per interned layout, with its formats set up once, and drawing
+ * a mesh only swaps the vertex and index buffers the vertex array reads from.
+ *
+ * Typical usage, ideally with the draws sorted by layout:
+ *
+ * @code
+ * cache.bind(mesh.vertices, mesh.indices);
+ * glDrawElements(GL_TRIANGLES, mesh.indices.count(), mesh.indices.type(),
+ *                nullptr);
+ * @endcode
+ *
+ * @note The vertex arrays of the cache do not own any buffer.
+ *
+ * @see VertexBufferLayout::intern
+ * @see VertexArray::add_vertex_format
+ */
+class VertexArrayCache {
+public:
+    VertexArrayCache() = default;
+    ~VertexArrayCache() = default;
+
+    VertexArrayCache(const VertexArrayCache&) = delete;
+    auto operator=(const VertexArrayCache&) -> VertexArrayCache& = delete;
+
+    VertexArrayCache(VertexArrayCache&&) noexcept = default;
+    auto operator=(VertexArrayCache&&) noexcept -> VertexArrayCache& = default;
+
+    /**
+     * @brief Get the vertex array of a layout, creating it if needed.
+     *
+     * @param layout the layout of the vertices.
+     * @return VertexArray& the vertex array shared by every vertex buffer with
+     * the same format, its vertex buffer binding is 0.
+     */
+    auto get(const VertexBufferLayout& layout) -> VertexArray&;
+
+    /**
+     * @brief Bind the vertex array matching the layout of a vertex buffer, and
+     * make it read from the vertex buffer.
+     *
+     * @param vertices the vertex buffer to draw.
+     */
+    void bind(const VertexBuffer& vertices);
+
+    /**
+     * @brief Bind the vertex array matching the layout of a vertex buffer, and
+     * make it read from the vertex and index buffers.
+     *
+     * @param vertices the vertex buffer to draw.
+     * @param indices the index buffer to draw.
+     */
+    void bind(const VertexBuffer& vertices, const IndexBuffer& indices);
+
+    /**
+     * @brief Destroy every vertex array of the cache.
+     *
+     */
+    void clear() noexcept { arrays_.clear(); }
+
+    // UTILITIES
+
+    /**
+     * @brief Get the number of vertex arrays, that is of distinct formats.
+     *
+     */
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+        return arrays_.size();
+    }
+
+private:
+    // keyed by interned layout, compared by address
+    std::unordered_map<const VertexBufferLayout*, VertexArray> arrays_;
+};
+
+/*
+
+        IMPLEMENTATIONS
+
+*/
+
+inline auto VertexArrayCache::get(const VertexBufferLayout& layout)
+    -> VertexArray& {
+    auto const& interned = VertexBufferLayout::intern(layout);
+    auto [it, inserted] = arrays_.try_emplace(&interned);
+
+    if (inserted) {
+        it->second.add_vertex_format(interned);
+    }
+
+    return it->second;
+}
+
+inline void VertexArrayCache::bind(const VertexBuffer& vertices) {
+    VertexArray const& vao = get(vertices.layout());
+
+    vao.set_vertex_buffer(0, vertices);
+    vao.bind();
+}
+
+inline void VertexArrayCache::bind(const VertexBuffer& vertices,
+                                   const IndexBuffer& indices) {
+    VertexArray const& vao = get(vertices.layout());
+
+    vao.set_vertex_buffer(0, vertices);
+    vao.set_element_buffer(indices);
+    vao.bind();
+}
+
+}  // namespace rgl
\ No newline at end of file
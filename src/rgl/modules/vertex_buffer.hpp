@@ -1,7 +1,10 @@
 #pragma once
+#include "buffer_arena.hpp"
 #include "gl_functions.hpp"
 #include "vertex_buffer_layout.hpp"
 #include <concepts>
+#include <cstddef>
+#include <cstdio>
 #include <functional>
 #include <span>
 #include <utility>
@@ -53,6 +56,10 @@ enum DriverAccessSpecifier {
  * in the GPU's memory, the data is passed as a pointer and is then accessed
  * through a user-specified layout.
  *
+ * A vertex buffer can also be a view into a rgl::BufferArena, in which case it
+ * does not own a buffer object but a range of the arena, given back on
+ * destruction.
+ *
  * @see
  * https://www.khronos.org/opengl/wiki/Vertex_Specification#Vertex_Buffer_Object
  * @see vertex_buffer_layout.hpp
@@ -77,6 +84,40 @@ public:
                  const VertexBufferLayout& layout) noexcept;
     VertexBuffer(std::span<const float> vertices, VertexBufferLayout layout,
                  DriverDrawHint hint) noexcept;
+
+    /**
+     * @brief Construct a new vertex buffer object from raw bytes.
+     *
+     * @details To be used when the attributes are not all floats, for
+     * instance with half float, normalized or integer attributes, the bytes
+     * being laid out according to the layout.
+     *
+     * @param vertices the bytes of the vertices.
+     * @param layout the layout of the vertices.
+     * @param hint the usage hint of the buffer.
+     */
+    VertexBuffer(std::span<const std::byte> vertices, VertexBufferLayout layout,
+                 DriverDrawHint hint = DriverDrawHint::DYNAMIC_DRAW) noexcept;
+
+    /**
+     * @brief Construct a new vertex buffer object as a view into an arena.
+     *
+     * @details The range is aligned to the stride of the layout, so that
+     * base_vertex() is exact and every view of the arena sharing the layout
+     * can be drawn through a single vertex array.
+     *
+     * @note If the arena is full, the vertex buffer is left with an id of 0.
+     *
+     * @param arena the arena to allocate from, must outlive the view.
+     * @param vertices the vertices, copied into the arena.
+     * @param layout the layout of the vertices.
+     * @see rgl::BufferArena
+     */
+    VertexBuffer(BufferArena& arena, std::span<const float> vertices,
+                 VertexBufferLayout layout) noexcept;
+    VertexBuffer(BufferArena& arena, std::span<const std::byte> vertices,
+                 VertexBufferLayout layout) noexcept;
+
     ~VertexBuffer();
 
     // delete copy and assignment, only move is allowed
@@ -111,9 +152,13 @@ public:
      * @brief Give new data to the vertex buffer object, overwriting the old
      * one.
      *
+     * @note A view is moved to another range of its arena if the new data
+     * does not fit in its current one. If the arena cannot hold the new data,
+     * the view keeps its range and its previous data.
+     *
      */
-
-    void set_data(std::span<const float> vertices) const noexcept;
+    void set_data(std::span<const float> vertices) noexcept;
+    void set_data(std::span<const std::byte> vertices) noexcept;
 
     // UTILITIES
 
@@ -133,6 +178,35 @@ public:
         return layout_.stride();
     }
 
+    /**
+     * @brief Check whether the vertex buffer object is a view into an arena.
+     *
+     */
+    [[nodiscard]] constexpr auto is_view() const noexcept -> bool {
+        return arena_ != nullptr;
+    }
+
+    /**
+     * @brief Get the offset of the vertices in the buffer object, in bytes,
+     * always 0 unless the vertex buffer object is a view.
+     *
+     */
+    [[nodiscard]] constexpr auto offset() const noexcept -> std::size_t {
+        return range_.offset;
+    }
+
+    /**
+     * @brief Get the index of the first vertex in the buffer object, to be
+     * used as the base vertex of draws sharing the arena.
+     *
+     */
+    [[nodiscard]] constexpr auto base_vertex() const noexcept -> std::int32_t {
+        return layout_.stride() == 0
+                   ? 0
+                   : static_cast<std::int32_t>(range_.offset /
+                                               layout_.stride());
+    }
+
     /**
      * @brief Applies a function to the vertices of the vertex buffer object.
      *
@@ -163,9 +237,20 @@ public:
         const std::function<void(std::span<T> vertices)>& func,
         DriverAccessSpecifier access_specifier = rgl::READ_WRITE) noexcept;
 
+protected:
+    /**
+     * @brief Delete the buffer object, or give the range back to the arena
+     * for views.
+     *
+     */
+    void release() noexcept;
+
 protected:
     std::uint32_t id_{};
     VertexBufferLayout layout_;
+
+    BufferArena* arena_{};
+    ArenaRange range_{};
 };
 
 /*
@@ -174,7 +259,7 @@ protected:
 
 */
 
-inline VertexBuffer::VertexBuffer(std::span<const float> vertices,
+inline VertexBuffer::VertexBuffer(std::span<const std::byte> vertices,
                                   VertexBufferLayout layout,
                                   DriverDrawHint hint) noexcept
     : layout_(std::move(layout)) {
@@ -184,6 +269,11 @@ inline VertexBuffer::VertexBuffer(std::span<const float> vertices,
                  vertices.data(), hint);
 }
 
+inline VertexBuffer::VertexBuffer(std::span<const float> vertices,
+                                  VertexBufferLayout layout,
+                                  DriverDrawHint hint) noexcept
+    : VertexBuffer(std::as_bytes(vertices), std::move(layout), hint) {}
+
 inline VertexBuffer::VertexBuffer(std::span<const float> vertices,
                                   DriverDrawHint hint) noexcept
     : VertexBuffer(vertices, VertexBufferLayout{}, hint) {}
@@ -196,31 +286,63 @@ inline VertexBuffer::VertexBuffer(std::span<const float> vertices) noexcept
     : VertexBuffer(vertices, VertexBufferLayout{},
                    DriverDrawHint::DYNAMIC_DRAW) {}
 
-inline VertexBuffer::~VertexBuffer() {
-    if (id_ != 0) {
-        glDeleteBuffers(1, &id_);
+inline VertexBuffer::VertexBuffer(BufferArena& arena,
+                                  std::span<const float> vertices,
+                                  VertexBufferLayout layout) noexcept
+    : VertexBuffer(arena, std::as_bytes(vertices), std::move(layout)) {}
+
+inline VertexBuffer::VertexBuffer(BufferArena& arena,
+                                  std::span<const std::byte> vertices,
+                                  VertexBufferLayout layout) noexcept
+    : layout_(std::move(layout)),
+      arena_{&arena} {
+    auto const range = arena.allocate(vertices.size_bytes(), layout_.stride());
+
+    if (!range.has_value()) [[unlikely]] {
+        arena_ = nullptr;
+        return;
     }
+
+    id_ = arena.id();
+    range_ = range.value();
+    arena.write(range_.offset, vertices);
 }
 
+inline VertexBuffer::~VertexBuffer() { release(); }
+
 inline VertexBuffer::VertexBuffer(VertexBuffer&& other) noexcept
     : id_{other.id_},
-      layout_{std::move(other.layout_)} {
+      layout_{std::move(other.layout_)},
+      arena_{other.arena_},
+      range_{other.range_} {
     other.id_ = 0;
+    other.arena_ = nullptr;
 }
 
 inline auto VertexBuffer::operator=(VertexBuffer&& other) noexcept
     -> VertexBuffer& {
     if (this != &other) {
-        glDeleteBuffers(1, &id_);
+        release();
         id_ = other.id_;
         layout_ = other.layout_;
+        arena_ = other.arena_;
+        range_ = other.range_;
 
         other.id_ = 0;
+        other.arena_ = nullptr;
     }
 
     return *this;
 }
 
+inline void VertexBuffer::release() noexcept {
+    if (arena_ != nullptr) {
+        arena_->deallocate(range_);
+    } else if (id_ != 0) {
+        glDeleteBuffers(1, &id_);
+    }
+}
+
 inline void VertexBuffer::bind() const { glBindBuffer(GL_ARRAY_BUFFER, id_); }
 
 inline void VertexBuffer::unbind() { glBindBuffer(GL_ARRAY_BUFFER, 0); }
@@ -234,8 +356,35 @@ inline void VertexBuffer::set_layout(const VertexBufferLayout& layout) {
     return layout_;
 }
 
+inline void VertexBuffer::set_data(std::span<const float> vertices) noexcept {
+    set_data(std::as_bytes(vertices));
+}
+
 inline void VertexBuffer::set_data(
-    std::span<const float> vertices) const noexcept {
+    std::span<const std::byte> vertices) noexcept {
+    if (arena_ != nullptr) {
+        if (vertices.size_bytes() > range_.size) {
+            // the current range is only given back once the new one is held
+            auto const range =
+                arena_->allocate(vertices.size_bytes(), layout_.stride());
+
+            if (!range.has_value()) [[unlikely]] {
+#ifdef RGL_DEBUG
+                std::fprintf(stderr,
+                             RGL_LINEINFO
+                             ", vertex buffer view not resized, its previous "
+                             "data is kept\n");
+#endif  // RGL_DEBUG
+                return;
+            }
+            arena_->deallocate(range_);
+            range_ = range.value();
+        }
+
+        arena_->write(range_.offset, vertices);
+        return;
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, id_);
     glBufferData(GL_ARRAY_BUFFER, static_cast<ptrdiff_t>(vertices.size_bytes()),
                  vertices.data(), GL_STATIC_DRAW);
@@ -244,6 +393,27 @@ inline void VertexBuffer::set_data(
 template <PlainOldData T>
 void VertexBuffer::apply(const std::function<void(std::span<T> vertices)>& func,
                          DriverAccessSpecifier access_specifier) noexcept {
+    if (arena_ != nullptr) {
+        std::uint32_t access{};
+        if (access_specifier != rgl::WRITE_ONLY) {
+            access |= GL_MAP_READ_BIT;
+        }
+        if (access_specifier != rgl::READ_ONLY) {
+            access |= GL_MAP_WRITE_BIT;
+        }
+
+        func(std::span{
+            reinterpret_cast<T*>(  // NOLINT (reinterpret-cast)
+                glMapNamedBufferRange(id_,
+                                      static_cast<ptrdiff_t>(range_.offset),
+                                      static_cast<ptrdiff_t>(range_.size),
+                                      access)),
+            range_.size / sizeof(T)});
+
+        glUnmapNamedBuffer(id_);
+        return;
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, id_);
 
     int32_t buffer_size{};
@@ -4,12 +4,155 @@
 #include "vertex_buffer.hpp"
 #include "vertex_buffer_layout.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <numbers>
+#include <optional>
 #include <span>
+#include <vector>
 
 namespace rgl {
 
+/**
+ * @brief Enum that specifies how the storage of an instance buffer is managed.
+ *
+ * @details `buffered` is the classic mutable buffer, every instance write is
+ * uploaded to the GPU right away through glBufferSubData.
+ *
+ * `deferred` uses the same mutable buffer, but instance writes only land in a
+ * CPU-side copy of the instances and the written indices are recorded as dirty
+ * ranges. `VertexBufferInst::flush()` merges overlapping, adjacent and nearby
+ * ranges (see `VertexBufferInst::set_merge_gap()`) and uploads each merged
+ * range with a single glBufferSubData.
+ *
+ * `persistent` allocates immutable storage through glBufferStorage and keeps it
+ * persistently and coherently mapped. The storage is split in
+ * `VertexBufferInst::region_count` regions used as a ring: instance writes are
+ * plain memory copies into a CPU-side copy of the instances and no GL call is
+ * issued until `VertexBufferInst::flush()` publishes them into the next free
+ * region. Regions are guarded by fences so that the CPU never overwrites data
+ * the GPU is still reading, and each region tracks the instances written since
+ * it was last published, so that only those are copied into it. If the driver
+ * fails to map the storage, the buffer falls back to `buffered`.
+ *
+ * @see https://www.khronos.org/opengl/wiki/Buffer_Object#Persistent_mapping
+ */
+enum class InstanceStorage : std::uint8_t {
+    buffered,
+    deferred,
+    persistent,
+};
+
+/**
+ * @brief Policy that decides how much an instance buffer grows when it runs
+ * out of space.
+ *
+ * @details Capacities are expressed in instances:
+ * - `geometric` multiplies the capacity by `factor`, never growing by less
+ *   than `chunk` instances, like std::vector does. This is the default.
+ * - `fixed_chunk` grows by multiples of `chunk` instances, useful when the
+ *   memory overhead of geometric growth is not acceptable.
+ * - `exact` grows to exactly the required number of instances, meant to be
+ *   paired with VertexBufferInst::reserve().
+ */
+struct GrowthPolicy {
+    enum class Kind : std::uint8_t {
+        geometric,
+        fixed_chunk,
+        exact,
+    };
+
+    Kind kind{Kind::geometric};
+    double factor{std::numbers::phi};
+    std::size_t chunk{32};
+
+    [[nodiscard]] static constexpr auto geometric(
+        double factor = std::numbers::phi) noexcept -> GrowthPolicy {
+        return {Kind::geometric, factor, 32};
+    }
+
+    /**
+     * @brief Grow by multiples of `instances`, clamped to at least 1.
+     *
+     */
+    [[nodiscard]] static constexpr auto fixed_chunk(
+        std::size_t instances) noexcept -> GrowthPolicy {
+        return {Kind::fixed_chunk, 1.0, std::max<std::size_t>(instances, 1)};
+    }
+
+    [[nodiscard]] static constexpr auto exact() noexcept -> GrowthPolicy {
+        return {Kind::exact, 1.0, 1};
+    }
+
+    /**
+     * @brief Compute the new capacity of a buffer.
+     *
+     * @param capacity the current capacity, in instances.
+     * @param required the number of instances that must fit.
+     * @return std::size_t the new capacity, in instances, at least `required`.
+     */
+    [[nodiscard]] constexpr auto next_capacity(
+        std::size_t capacity, std::size_t required) const noexcept
+        -> std::size_t {
+        switch (kind) {
+            case Kind::geometric: {
+                auto const scaled = static_cast<std::size_t>(
+                    static_cast<double>(capacity) * factor);
+                return std::max({required, scaled, capacity + chunk});
+            }
+            case Kind::fixed_chunk: {
+                // aggregate-initialized policies skip the factory clamp
+                auto const step = std::max<std::size_t>(chunk, 1);
+                return (required + step - 1) / step * step;
+            }
+            case Kind::exact:
+            default: return required;
+        }
+    }
+};
+
+/**
+ * @brief A contiguous range of instances.
+ *
+ */
+struct InstanceRange {
+    std::int32_t first{};
+    std::int32_t count{};
+};
+
+/**
+ * @brief Stable handle to an instance of a VertexBufferInst.
+ *
+ * @details Unlike indices, handles are not affected when other instances are
+ * deleted and the buffer is compacted. Handles of deleted instances are
+ * detected through their generation, even after their slot has been reused by
+ * a new instance.
+ *
+ * @see VertexBufferInst::create_instance
+ */
+struct InstanceHandle {
+    static constexpr std::uint32_t null_index = 0xFFFFFFFF;
+
+    std::uint32_t index{null_index};
+    std::uint32_t generation{};
+
+    [[nodiscard]] constexpr auto operator==(const InstanceHandle&) const
+        -> bool = default;
+};
+
+/**
+ * @brief An instance that was moved from one index to another.
+ *
+ */
+struct InstanceMove {
+    std::int32_t from{};
+    std::int32_t to{};
+};
+
 /**
  * @brief A vertex buffer object for instanced rendering.
  *
@@ -40,13 +183,43 @@ namespace rgl {
  * instance (which is the index of the last instance in the buffer before the
  deletion).
  *
+ * Alternatively, instances can be added through create_instance(), which
+ returns a stable handle that keeps referring to the instance no matter how
+ the buffer is compacted.
+ *
  * @see vertex_buffer.hpp
  *
  * @attention None of the base class methods are virtual, so this class is not
  meant to be used polymorphically.
+ *
+ * @note When constructed with `InstanceStorage::deferred` or
+ `InstanceStorage::persistent`, writes are deferred until flush() is called,
+ which is meant to happen once per frame before drawing. With persistent
+ storage the buffer's id and the offset of the region to draw from
+ change over time, vertex_array takes care of re-pointing its instanced
+ attributes when it is bound. apply() and set_data() hide the base class
+ ones and go through the CPU-side copy of those buffers.
+
+ * @warning Buffers written by the GPU, such as the outputs of
+ FrustumCuller::cull() and LodSelector::select(), must use buffered storage and
+ must not be edited through the instance API: their instance count does not
+ follow what the GPU wrote, and CPU writes would overwrite the GPU results.
 
  */
 class VertexBufferInst : public VertexBuffer {
+public:
+    /**
+     * @brief Number of regions a persistent buffer is split in.
+     *
+     */
+    static constexpr std::size_t region_count = 3;
+
+    /**
+     * @brief Default merge gap of deferred buffers, in instances.
+     *
+     */
+    static constexpr std::int32_t default_merge_gap = 16;
+
 private:
     /**
      * @brief The capacity of the buffer, in bytes.
@@ -61,98 +234,683 @@ private:
     std::int32_t count_{};
 
     /**
-     * @brief Compute the new capacity of the buffer, given the current
-     * capacity.
+     * @brief How the storage of the buffer is managed.
+     *
+     */
+    InstanceStorage storage_{InstanceStorage::buffered};
+
+    /**
+     * @brief CPU-side copy of the instances, sized to the capacity, only kept
+     * by deferred and persistent buffers, whose GPU copy lags behind it.
+     *
+     */
+    std::vector<std::byte> shadow_;
+
+    /**
+     * @brief Ranges of instances written since the last flush, only used by
+     * deferred buffers.
+     *
+     */
+    std::vector<InstanceRange> dirty_;
+
+    /**
+     * @brief Maximum number of clean instances between two dirty ranges for
+     * them to be uploaded as one.
+     *
+     */
+    std::int32_t merge_gap_{default_merge_gap};
+
+    /**
+     * @brief Pointer to the persistently mapped storage (all regions).
+     *
+     */
+    std::byte* mapped_{};
+
+    /**
+     * @brief Fences guarding each region of a persistent buffer.
+     *
+     */
+    std::array<GLsync, region_count> fences_{};
+
+    /**
+     * @brief The region the GPU currently reads the instances from.
+     *
+     */
+    std::size_t region_{};
+
+    /**
+     * @brief Ranges of instances written since each region of a persistent
+     * buffer was last published.
+     *
+     */
+    std::array<std::vector<InstanceRange>, region_count> stale_{};
+
+    /**
+     * @brief How the capacity of the buffer grows when it runs out of space.
+     *
+     */
+    GrowthPolicy growth_{};
+
+    /**
+     * @brief Sparse set mapping handles to instances.
+     *
+     * @details `sparse_` maps the index of a handle to the index of its
+     * instance, or to the next free handle index when the handle is free.
+     * `dense_` maps the index of an instance to the index of its handle, or to
+     * InstanceHandle::null_index for instances added without a handle.
+     * `generations_` holds the current generation of every handle index, it is
+     * bumped whenever a handle is released.
+     */
+    std::vector<std::uint32_t> sparse_;
+    std::vector<std::uint32_t> dense_;
+    std::vector<std::uint32_t> generations_;
+    std::uint32_t free_handle_{InstanceHandle::null_index};
+
+    /**
+     * @brief Resize the buffer to the given capacity.
+     *
+     * @details A new buffer is allocated, the live instances are copied into
+     * it with a single GPU-side copy and the old buffer is deleted.
      *
-     * @param capacity the current capacity of the buffer.
+     * @see Side effects: the id of the buffer changes, no binding point is
+     * modified.
      *
-     * @return std::size_t the new capacity of the buffer.
+     * @param new_capacity the new capacity of the buffer, in bytes.
      */
-    [[nodiscard]] constexpr auto calc_capacity(
-        std::size_t capacity) const noexcept -> std::size_t {
-        std::size_t new_cap{0};
+    void resize_buffer(std::size_t new_capacity) noexcept {
+        std::uint32_t new_id{};
+        glCreateBuffers(1, &new_id);
+        glNamedBufferData(new_id, static_cast<ptrdiff_t>(new_capacity),
+                          nullptr, GL_DYNAMIC_DRAW);
 
-        if (capacity == 0) [[unlikely]] {
-            new_cap = instance_size();
-        } else if (capacity == instance_size()) [[unlikely]] {
-            new_cap = instance_size() * 32;
-        } else [[likely]] {
-            new_cap = static_cast<size_t>(static_cast<double>(capacity) *
-                                          std::numbers::phi);
+        glCopyNamedBufferSubData(
+            id_, new_id, 0, 0,
+            static_cast<ptrdiff_t>(count_ * layout_.stride()));
+
+        glDeleteBuffers(1, &id_);
+        id_ = new_id;
+    }
+
+    /**
+     * @brief Grow the storage of the buffer, according to its storage
+     * strategy.
+     *
+     * @param new_capacity the new capacity of the buffer, in bytes.
+     */
+    void grow(std::size_t new_capacity) noexcept {
+        if (storage_ != InstanceStorage::buffered) {
+            shadow_.resize(new_capacity);
         }
 
-        return new_cap;
+        if (storage_ == InstanceStorage::persistent) {
+            allocate_persistent(new_capacity);
+        } else {
+            resize_buffer(new_capacity);
+        }
+        capacity_ = new_capacity;
     }
 
     /**
-     * @brief Resize the buffer to the given capacity.
+     * @brief (Re)allocate the immutable storage of a persistent buffer.
      *
-     * @param id the id of the buffer to be resized.
+     * @details Immutable storage cannot grow, so a new buffer is created and
+     * mapped, and the instances are copied into its first region from the CPU
+     * copy, the other regions are refreshed by the next flushes. The old
+     * buffer is deleted, the driver keeps it alive until the GPU is done with
+     * it.
      *
-     * @see Side effects: the old buffer will be deleted and the new buffer will
-     * be bound to GL_ARRAY_BUFFER.
+     * If the storage cannot be mapped, it is replaced by a mutable buffer
+     * holding the CPU copy and the buffer falls back to buffered storage.
      *
-     * @param capacity the new capacity of the buffer, in bytes.
+     * @see Side effects: the id of the buffer changes, no binding point is
+     * modified.
+     *
+     * @param capacity the capacity of a single region, in bytes.
      */
-    void resize_buffer(std::size_t old_capacity,
-                       std::size_t new_capacity) noexcept {
-        // 1. create new buffer as big as old buffer
-        // 2. copy old buffer to new buffer
-        // 3. grow old buffer to new size
-        // 4. copy new buffer to old buffer
-        // 5. delete new buffer
+    void allocate_persistent(std::size_t capacity) noexcept {
+        release_fences();
+        glDeleteBuffers(1, &id_);
 
-        std::uint32_t new_id{};
-        glGenBuffers(1, &new_id);
+        constexpr GLbitfield flags =
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        auto const total_size = static_cast<ptrdiff_t>(capacity * region_count);
+
+        glCreateBuffers(1, &id_);
+        glNamedBufferStorage(id_, total_size, nullptr, flags);
+        mapped_ = static_cast<std::byte*>(
+            glMapNamedBufferRange(id_, 0, total_size, flags));
+
+        region_ = 0;
+        for (auto& stale : stale_) {
+            stale.clear();
+        }
+
+        if (mapped_ == nullptr) [[unlikely]] {
+#ifdef RGL_DEBUG
+            std::fprintf(stderr,
+                         RGL_LINEINFO
+                         ", cannot map persistent instance storage, falling "
+                         "back to buffered storage\n");
+#endif  // RGL_DEBUG
+            glDeleteBuffers(1, &id_);
+            glCreateBuffers(1, &id_);
+            glNamedBufferData(id_, static_cast<ptrdiff_t>(capacity),
+                              shadow_.data(), GL_DYNAMIC_DRAW);
+            storage_ = InstanceStorage::buffered;
+            shadow_ = {};
+            return;
+        }
+
+        std::memcpy(mapped_, shadow_.data(), count_ * layout_.stride());
+        for (std::size_t region = 1; region < region_count; region++) {
+            stale_[region].push_back({0, count_});
+        }
+    }
+
+    /**
+     * @brief Block until the GPU is done reading from a region.
+     *
+     * @param region the index of the region to wait for.
+     */
+    void wait_region(std::size_t region) noexcept {
+        GLsync& fence = fences_[region];
+        if (fence == nullptr) [[likely]] {
+            return;
+        }
+
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        while (status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                      1'000'000);  // 1ms
+        }
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    /**
+     * @brief Record a range of instances as written since the last flush.
+     *
+     * @details Writes to the same or to consecutive instances, which are the
+     * common case, extend the last range instead of adding a new one.
+     *
+     * @param ranges the ranges written so far.
+     * @param range the range of written instances.
+     */
+    static void mark_dirty(std::vector<InstanceRange>& ranges,
+                           InstanceRange range) {
+        if (!ranges.empty()) [[likely]] {
+            auto& last = ranges.back();
+            auto const last_end = last.first + last.count;
+            if (range.first >= last.first && range.first <= last_end) {
+                last.count =
+                    std::max(last_end, range.first + range.count) - last.first;
+                return;
+            }
+        }
+
+        ranges.push_back(range);
+    }
+
+    /**
+     * @brief Sort and merge written ranges, then clear them.
+     *
+     * @details Ranges are merged whenever they overlap or are at most `gap`
+     * instances apart, the part of a merged range past the last instance is
+     * dropped.
+     *
+     * @param ranges the written ranges.
+     * @param gap the maximum gap between two merged ranges, in instances.
+     * @param func the function called with each merged range.
+     */
+    template <typename Func>
+    void merge_ranges(std::vector<InstanceRange>& ranges, std::int32_t gap,
+                      Func&& func) const {
+        if (ranges.empty()) {
+            return;
+        }
+
+        std::sort(ranges.begin(), ranges.end(),
+                  [](InstanceRange lhs, InstanceRange rhs) {
+                      return lhs.first < rhs.first;
+                  });
+
+        auto const emit = [&](InstanceRange range) {
+            auto const last = std::min(range.first + range.count, count_);
+            if (last > range.first) {
+                func(InstanceRange{range.first, last - range.first});
+            }
+        };
+
+        InstanceRange merged = ranges.front();
+        for (auto const& range : ranges) {
+            auto const merged_end = merged.first + merged.count;
+            if (range.first <= merged_end + gap) {
+                merged.count = std::max(merged_end, range.first + range.count) -
+                               merged.first;
+            } else {
+                emit(merged);
+                merged = range;
+            }
+        }
+        emit(merged);
 
-        glBindBuffer(GL_COPY_WRITE_BUFFER, new_id);
-        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<ptrdiff_t>(old_capacity),
-                     nullptr, GL_DYNAMIC_DRAW);
+        ranges.clear();
+    }
+
+    /**
+     * @brief Record a range of instances written to the CPU-side copy, to be
+     * published by the next flush().
+     *
+     * @param range the range of written instances.
+     */
+    void commit(InstanceRange range) {
+        switch (storage_) {
+            case InstanceStorage::deferred: mark_dirty(dirty_, range); break;
+            case InstanceStorage::persistent:
+                for (auto& stale : stale_) {
+                    mark_dirty(stale, range);
+                }
+                break;
+            case InstanceStorage::buffered:  // no CPU-side copy
+            default: break;
+        }
+    }
+
+    /**
+     * @brief Write consecutive instances, according to the storage strategy.
+     *
+     * @details Buffered buffers upload the instances right away, the others
+     * copy them into the CPU-side copy, to be published by flush().
+     *
+     * @param first the index of the first written instance.
+     * @param instances the instances, tightly packed.
+     */
+    void write(std::int32_t first,
+               std::span<const std::byte> instances) noexcept {
+        auto const offset = first * layout_.stride();
+        if (storage_ == InstanceStorage::buffered) {
+            glNamedBufferSubData(id_, static_cast<ptrdiff_t>(offset),
+                                 static_cast<ptrdiff_t>(instances.size()),
+                                 instances.data());
+            return;
+        }
+
+        std::memcpy(shadow_.data() + offset, instances.data(),
+                    instances.size());
+        // a partial write still dirties its instance
+        auto const count = (instances.size() + layout_.stride() - 1) /
+                           layout_.stride();
+        commit({first, static_cast<std::int32_t>(count)});
+    }
+
+    /**
+     * @brief Copy consecutive instances over other ones.
+     *
+     * @details Buffered buffers copy the instances on the GPU, their GPU copy
+     * being the only one, the others copy them in the CPU-side copy.
+     *
+     * @param from the index of the first copied instance.
+     * @param to the index of the first overwritten instance, the ranges must
+     * not overlap.
+     * @param count the number of copied instances.
+     */
+    void copy_instances(std::int32_t from, std::int32_t to,
+                        std::int32_t count) noexcept {
+        auto const size = count * layout_.stride();
+        if (storage_ == InstanceStorage::buffered) {
+            glCopyNamedBufferSubData(
+                id_, id_, static_cast<ptrdiff_t>(from * layout_.stride()),
+                static_cast<ptrdiff_t>(to * layout_.stride()),
+                static_cast<ptrdiff_t>(size));
+            return;
+        }
+
+        std::memcpy(shadow_.data() + to * layout_.stride(),
+                    shadow_.data() + from * layout_.stride(), size);
+        commit({to, count});
+    }
+
+    /**
+     * @brief Append instances, growing the buffer at most once.
+     *
+     * @param instances the instances, tightly packed.
+     */
+    void append(std::span<const std::byte> instances) noexcept;
+
+    /**
+     * @brief Upload a range of instances from the CPU-side copy.
+     *
+     * @param range the range of instances to upload, the part past the last
+     * instance is ignored.
+     */
+    void upload_range(InstanceRange range) const noexcept {
+        auto const last = std::min(range.first + range.count, count_);
+        if (last <= range.first) {
+            return;
+        }
 
-        glBindBuffer(GL_COPY_READ_BUFFER, id_);
+        glNamedBufferSubData(
+            id_, static_cast<ptrdiff_t>(range.first * layout_.stride()),
+            static_cast<ptrdiff_t>((last - range.first) * layout_.stride()),
+            shadow_.data() + range.first * layout_.stride());
+    }
 
-        // copy the data from the old buffer to the new one
+    /**
+     * @brief Give a handle to an instance, reusing a released handle index if
+     * possible.
+     *
+     * @param index the index of the instance.
+     * @return InstanceHandle the new handle.
+     */
+    auto acquire_handle(std::int32_t index) -> InstanceHandle {
+        std::uint32_t handle_index = free_handle_;
+        if (handle_index != InstanceHandle::null_index) {
+            free_handle_ = sparse_[handle_index];
+        } else {
+            handle_index = static_cast<std::uint32_t>(sparse_.size());
+            sparse_.push_back({});
+            generations_.push_back({});
+        }
 
-        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
-                            static_cast<ptrdiff_t>(count_ * layout_.stride()));
+        sparse_[handle_index] = static_cast<std::uint32_t>(index);
+        dense_[index] = handle_index;
 
-        glBindBuffer(GL_COPY_WRITE_BUFFER, id_);
-        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<ptrdiff_t>(new_capacity),
-                     nullptr, GL_DYNAMIC_DRAW);
+        return {handle_index, generations_[handle_index]};
+    }
 
-        glBindBuffer(GL_COPY_READ_BUFFER, new_id);
+    /**
+     * @brief Release the handle of an instance, if it has one, invalidating
+     * every copy of it.
+     *
+     * @param index the index of the instance.
+     */
+    void release_handle(std::int32_t index) noexcept {
+        auto const handle_index = dense_[index];
+        if (handle_index == InstanceHandle::null_index) {
+            return;
+        }
 
-        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
-                            static_cast<ptrdiff_t>(count_ * layout_.stride()));
+        generations_[handle_index]++;
+        sparse_[handle_index] = free_handle_;
+        free_handle_ = handle_index;
+        dense_[index] = InstanceHandle::null_index;
+    }
 
-        glDeleteBuffers(1, &new_id);
-        glBindBuffer(GL_ARRAY_BUFFER, id_);
+    /**
+     * @brief Make the handle of an instance follow it when it is moved.
+     *
+     * @param from the old index of the instance.
+     * @param to the new index of the instance.
+     */
+    void relocate_handle(std::int32_t from, std::int32_t to) noexcept {
+        dense_[to] = dense_[from];
+        if (dense_[to] != InstanceHandle::null_index) {
+            sparse_[dense_[to]] = static_cast<std::uint32_t>(to);
+        }
+    }
+
+    /**
+     * @brief Delete every pending fence.
+     *
+     */
+    void release_fences() noexcept {
+        for (auto& fence : fences_) {
+            if (fence != nullptr) {
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
     }
 
 public:
     VertexBufferInst(std::span<const float> instance_data,
                      const VertexBufferLayout& layout) noexcept
         : VertexBuffer{instance_data, layout, DriverDrawHint::DYNAMIC_DRAW},
-          capacity_{instance_data.size()} {};
+          capacity_{instance_data.size_bytes()},
+          count_{initial_count(instance_data, layout)},
+          dense_(count_, InstanceHandle::null_index) {};
 
     VertexBufferInst(std::span<const float> instance_data) noexcept
         : VertexBuffer{instance_data, DriverDrawHint::DYNAMIC_DRAW},
-          capacity_{instance_data.size()} {};
+          capacity_{instance_data.size_bytes()} {};
+
+    /**
+     * @brief Construct a new instance buffer with the given storage strategy.
+     *
+     * @param instance_data the initial instances, can be empty.
+     * @param layout the layout of a single instance.
+     * @param storage how the storage of the buffer is managed.
+     * @see rgl::InstanceStorage
+     */
+    VertexBufferInst(std::span<const float> instance_data,
+                     const VertexBufferLayout& layout,
+                     InstanceStorage storage) noexcept;
 
-    ~VertexBufferInst() noexcept = default;
+    ~VertexBufferInst() noexcept { release_fences(); }
 
     VertexBufferInst(const VertexBufferInst&) = delete;
     auto operator=(const VertexBufferInst&) -> VertexBufferInst& = delete;
 
-    VertexBufferInst(VertexBufferInst&&) noexcept = default;
-    [[nodiscard]] auto operator=(VertexBufferInst&&) noexcept
-        -> VertexBufferInst& = default;
+    VertexBufferInst(VertexBufferInst&& other) noexcept;
+    [[nodiscard]] auto operator=(VertexBufferInst&& other) noexcept
+        -> VertexBufferInst&;
 
     void add_instance(std::span<const float> instance_data) noexcept;
     auto delete_instance(std::int32_t index) noexcept -> int32_t;
     void update_instance(std::int32_t index,
                          std::span<const float> instance_data) noexcept;
 
+    /**
+     * @brief Append several instances at once.
+     *
+     * @details The instances are copied in the CPU-side copy and uploaded as a
+     * single range, growing the buffer at most once.
+     *
+     * @param instances the instances to add, tightly packed according to the
+     * layout of the buffer.
+     */
+    void add_instances(std::span<const float> instances) noexcept;
+
+    /**
+     * @brief Delete several instances at once.
+     *
+     * @details Deleted instances that are not at the end of the buffer are
+     * filled with the surviving instances at the end of the buffer
+     * (swap-and-pop), the compaction happens on the CPU-side copy and the
+     * moved instances are uploaded once, never reading back from the GPU.
+     * Invalid and duplicate indices are ignored.
+     *
+     * @param indices the indices of the instances to delete, in any order.
+     * @return std::vector<InstanceMove> every instance that changed index, so
+     * that the caller can fix up the indices it keeps, instances that are not
+     * listed have kept their index.
+     */
+    auto delete_instances(std::span<const std::int32_t> indices) noexcept
+        -> std::vector<InstanceMove>;
+
+    /**
+     * @brief Replace every instance of the buffer.
+     *
+     * @details Hides VertexBuffer::set_data(), which would reallocate the
+     * buffer behind the capacity and the CPU-side copy. The handles of the
+     * previous instances are released.
+     *
+     * @param instances the new instances, tightly packed according to the
+     * layout of the buffer.
+     */
+    void set_data(std::span<const float> instances) noexcept;
+    void set_data(std::span<const std::byte> instances) noexcept;
+
+    /**
+     * @brief Applies a function to the instances of the buffer.
+     *
+     * @details Hides VertexBuffer::apply(). Deferred and persistent buffers
+     * apply the function to their CPU-side copy, which stays authoritative,
+     * and publish every instance on the next flush() unless the access is
+     * READ_ONLY. Buffered buffers map their storage, as VertexBuffer::apply()
+     * does.
+     *
+     * @param func the function to be applied to the instances.
+     * @param access_specifier the access mode of the instances.
+     * @tparam T a type that represents an instance, tightly packed.
+     */
+    template <PlainOldData T>
+    void apply(
+        const std::function<void(std::span<T> instances)>& func,
+        DriverAccessSpecifier access_specifier = rgl::READ_WRITE) noexcept;
+
+    /**
+     * @brief Add an instance and give it a stable handle.
+     *
+     * @details Handles keep referring to the same instance while the buffer is
+     * compacted by deletions, so callers do not have to track index moves.
+     * The buffer itself stays densely packed for instanced draws.
+     *
+     * @param instance_data the instance to add.
+     * @return InstanceHandle the handle of the new instance.
+     */
+    auto create_instance(std::span<const float> instance_data) noexcept
+        -> InstanceHandle;
+
+    /**
+     * @brief Add several instances at once and give each a stable handle.
+     *
+     * @param instances the instances to add, tightly packed according to the
+     * layout of the buffer.
+     * @return std::vector<InstanceHandle> the handles of the new instances, in
+     * the same order.
+     */
+    auto create_instances(std::span<const float> instances) noexcept
+        -> std::vector<InstanceHandle>;
+
+    /**
+     * @brief Delete the instance referred to by a handle.
+     *
+     * @param handle the handle of the instance to delete.
+     * @return true if the instance was deleted, false if the handle was stale.
+     */
+    auto destroy_instance(InstanceHandle handle) noexcept -> bool;
+
+    /**
+     * @brief Delete the instances referred to by several handles at once.
+     *
+     * @details Stale handles are ignored, see delete_instances().
+     *
+     * @param handles the handles of the instances to delete.
+     * @return std::size_t the number of deleted instances.
+     */
+    auto destroy_instances(std::span<const InstanceHandle> handles) noexcept
+        -> std::size_t;
+
+    /**
+     * @brief Update the instance referred to by a handle.
+     *
+     * @param handle the handle of the instance, stale handles are ignored.
+     * @param instance_data the new data of the instance.
+     */
+    void update_instance(InstanceHandle handle,
+                         std::span<const float> instance_data) noexcept;
+
+    /**
+     * @brief Check if a handle refers to a live instance.
+     *
+     */
+    [[nodiscard]] constexpr auto contains(InstanceHandle handle) const noexcept
+        -> bool {
+        return handle.index < generations_.size() &&
+               generations_[handle.index] == handle.generation;
+    }
+
+    /**
+     * @brief Get the current index of the instance referred to by a handle.
+     *
+     * @return std::optional<std::int32_t> the index of the instance, or
+     * std::nullopt if the handle is stale.
+     */
+    [[nodiscard]] constexpr auto index_of(InstanceHandle handle) const noexcept
+        -> std::optional<std::int32_t> {
+        if (!contains(handle)) {
+            return std::nullopt;
+        }
+        return static_cast<std::int32_t>(sparse_[handle.index]);
+    }
+
+    /**
+     * @brief Get the handle of the instance at an index.
+     *
+     * @return InstanceHandle the handle, or a null handle if the instance was
+     * added without one.
+     */
+    [[nodiscard]] constexpr auto handle_at(std::int32_t index) const noexcept
+        -> InstanceHandle {
+        auto const handle_index = dense_[index];
+        if (handle_index == InstanceHandle::null_index) {
+            return {};
+        }
+        return {handle_index, generations_[handle_index]};
+    }
+
+    /**
+     * @brief Publish the pending instance writes of a deferred or persistent
+     * buffer.
+     *
+     * @details For deferred storage, the dirty ranges are sorted and merged
+     * whenever they overlap or are at most `merge_gap()` instances apart, then
+     * each merged range is uploaded with a single glBufferSubData.
+     *
+     * For persistent storage, nothing happens if no instance was written
+     * since the last flush, the GPU keeps reading the same region. Otherwise,
+     * fences the region the GPU has been drawing from, moves to the next
+     * region of the ring (waiting for the GPU to be done with it, which only
+     * happens when the CPU is more than `region_count - 1` frames ahead) and
+     * copies into it the instances written since it was last published.
+     *
+     * Call it once per frame, after the instances have been updated and
+     * before drawing.
+     *
+     * @note This is a no-op for buffered storage, whose writes are uploaded
+     * immediately.
+     */
+    void flush() noexcept;
+
+    /**
+     * @brief Set the merge gap used by flush() on deferred buffers.
+     *
+     * @details Two dirty ranges separated by at most `gap` clean instances are
+     * uploaded as a single range, trading some redundant bandwidth for fewer
+     * driver calls. A gap of 0 only merges overlapping and adjacent ranges.
+     *
+     * @param gap the maximum gap, in instances.
+     */
+    void set_merge_gap(std::int32_t gap) noexcept { merge_gap_ = gap; }
+    [[nodiscard]] constexpr auto merge_gap() const noexcept -> std::int32_t {
+        return merge_gap_;
+    }
+
+    /**
+     * @brief Make room for at least the given number of instances.
+     *
+     * @details Grows the buffer to exactly `instances` instances if it cannot
+     * hold them already, so that later calls to add_instance() do not need to
+     * reallocate. Meant to pre-size buffers at load time rather than mid-frame.
+     *
+     * @param instances the number of instances to make room for.
+     */
+    void reserve(std::size_t instances) noexcept;
+
+    /**
+     * @brief Set the policy used to grow the buffer when it runs out of space.
+     *
+     * @param policy the new growth policy.
+     * @see rgl::GrowthPolicy
+     */
+    void set_growth_policy(GrowthPolicy policy) noexcept { growth_ = policy; }
+    [[nodiscard]] constexpr auto growth_policy() const noexcept
+        -> GrowthPolicy {
+        return growth_;
+    }
+
     // UTLITIES
 
     [[nodiscard]] constexpr auto instance_count() const noexcept
@@ -165,6 +923,29 @@ public:
     [[nodiscard]] constexpr auto capacity() const noexcept -> std::size_t {
         return capacity_;
     }
+    [[nodiscard]] constexpr auto storage() const noexcept -> InstanceStorage {
+        return storage_;
+    }
+
+    /**
+     * @brief Get the byte offset of the instances the GPU should read.
+     *
+     * @details Always 0 for buffered and deferred storage, for persistent
+     * storage it is the offset of the region published by the last flush().
+     */
+    [[nodiscard]] constexpr auto offset() const noexcept -> std::size_t {
+        return region_ * capacity_;
+    }
+
+private:
+    [[nodiscard]] static constexpr auto initial_count(
+        std::span<const float> instance_data,
+        const VertexBufferLayout& layout) noexcept -> std::int32_t {
+        return layout.stride() == 0
+                   ? 0
+                   : static_cast<std::int32_t>(instance_data.size_bytes() /
+                                               layout.stride());
+    }
 
 };  // class vertex_buffer_inst
 
@@ -174,30 +955,111 @@ public:
 
 */
 
+inline VertexBufferInst::VertexBufferInst(std::span<const float> instance_data,
+                                          const VertexBufferLayout& layout,
+                                          InstanceStorage storage) noexcept
+    : VertexBufferInst{storage == InstanceStorage::persistent
+                           ? std::span<const float>{}
+                           : instance_data,
+                       layout} {
+    storage_ = storage;
+    if (storage == InstanceStorage::deferred) {
+        shadow_.assign(std::as_bytes(instance_data).begin(),
+                       std::as_bytes(instance_data).end());
+    }
+    if (storage != InstanceStorage::persistent) {
+        return;
+    }
+
+    capacity_ = instance_data.size_bytes() == 0
+                    ? growth_.next_capacity(0, 1) * instance_size()
+                    : instance_data.size_bytes();
+
+    shadow_.assign(capacity_, std::byte{});
+    if (!instance_data.empty()) {
+        std::memcpy(shadow_.data(), instance_data.data(),
+                    instance_data.size_bytes());
+        count_ = initial_count(instance_data, layout);
+        dense_.assign(count_, InstanceHandle::null_index);
+    }
+    allocate_persistent(capacity_);
+}
+
+inline VertexBufferInst::VertexBufferInst(VertexBufferInst&& other) noexcept
+    : VertexBuffer{std::move(other)},
+      capacity_{other.capacity_},
+      count_{other.count_},
+      storage_{other.storage_},
+      shadow_{std::move(other.shadow_)},
+      dirty_{std::move(other.dirty_)},
+      merge_gap_{other.merge_gap_},
+      mapped_{other.mapped_},
+      fences_{other.fences_},
+      region_{other.region_},
+      stale_{std::move(other.stale_)},
+      growth_{other.growth_},
+      sparse_{std::move(other.sparse_)},
+      dense_{std::move(other.dense_)},
+      generations_{std::move(other.generations_)},
+      free_handle_{other.free_handle_} {
+    other.mapped_ = nullptr;
+    other.fences_ = {};
+}
+
+inline auto VertexBufferInst::operator=(VertexBufferInst&& other) noexcept
+    -> VertexBufferInst& {
+    if (this != &other) {
+        release_fences();
+        VertexBuffer::operator=(std::move(other));
+        capacity_ = other.capacity_;
+        count_ = other.count_;
+        storage_ = other.storage_;
+        shadow_ = std::move(other.shadow_);
+        dirty_ = std::move(other.dirty_);
+        merge_gap_ = other.merge_gap_;
+        mapped_ = other.mapped_;
+        fences_ = other.fences_;
+        region_ = other.region_;
+        stale_ = std::move(other.stale_);
+        growth_ = other.growth_;
+        sparse_ = std::move(other.sparse_);
+        dense_ = std::move(other.dense_);
+        generations_ = std::move(other.generations_);
+        free_handle_ = other.free_handle_;
+
+        other.mapped_ = nullptr;
+        other.fences_ = {};
+    }
+
+    return *this;
+}
+
 inline void VertexBufferInst::add_instance(
     std::span<const float> instance_data) noexcept {
     if ((count_ + 1) * layout_.stride() > capacity_) [[unlikely]] {
-        auto new_capacity = calc_capacity(capacity_);
-        resize_buffer(capacity_, new_capacity);
-        capacity_ = new_capacity;
+        grow(growth_.next_capacity(capacity_ / instance_size(), count_ + 1) *
+             instance_size());
     }
 
-    update_instance(count_, instance_data);
     count_++;
+    dense_.push_back(InstanceHandle::null_index);
+    update_instance(count_ - 1, instance_data);
+}
+
+inline void VertexBufferInst::reserve(std::size_t instances) noexcept {
+    if (instances * instance_size() > capacity_) {
+        grow(instances * instance_size());
+    }
 }
 
 inline void VertexBufferInst::update_instance(
     std::int32_t index, std::span<const float> instance_data) noexcept {
 #ifdef RGL_DEBUG
     // too costly for release builds
-    assert(index < m_count || instance_data.size_bytes() == m_layout.stride());
+    assert(index < count_ || instance_data.size_bytes() == layout_.stride());
 #endif  // RGL_DEBUG
 
-    glBindBuffer(GL_ARRAY_BUFFER, id_);
-    glBufferSubData(GL_ARRAY_BUFFER,
-                    static_cast<ptrdiff_t>(index * instance_data.size_bytes()),
-                    static_cast<ptrdiff_t>(instance_data.size_bytes()),
-                    instance_data.data());
+    write(index, std::as_bytes(instance_data));
 }
 
 inline auto VertexBufferInst::delete_instance(std::int32_t index) noexcept
@@ -206,30 +1068,222 @@ inline auto VertexBufferInst::delete_instance(std::int32_t index) noexcept
         return count_;
     }  // pretend we did something
 
-    // move the last instance to the position of the deleted instance
+    // move the last instance to the position of the deleted instance, without
+    // reading back from the GPU
 
-    auto* last_instance_ptr = static_cast<float*>(glMapBufferRange(
-        GL_ARRAY_BUFFER,
-        static_cast<ptrdiff_t>((count_ - 1) * layout_.stride()),
-        static_cast<uint32_t>(layout_.stride()),
-        GL_MAP_WRITE_BIT | GL_MAP_READ_BIT));  // read the last instance
-
-    // write the last instance to the position of the deleted instance
-    // (overwriting it)
-
-    auto last_instance =
-        std::span<const float>{last_instance_ptr, layout_.stride_elements()};
-
-    update_instance(index, last_instance);
-
-    // we are done with the last instance, so we can unmap it
-    glUnmapBuffer(GL_ARRAY_BUFFER);
+    release_handle(index);
 
     // by reducing the count, we effectively delete the last instance
     // (preventing duplicates)
     count_--;
 
+    if (index != count_) {
+        copy_instances(count_, index, 1);
+        relocate_handle(count_, index);
+    }
+    dense_.pop_back();
+
     return index;
 }
 
+inline void VertexBufferInst::add_instances(
+    std::span<const float> instances) noexcept {
+    append(std::as_bytes(instances));
+}
+
+inline void VertexBufferInst::append(
+    std::span<const std::byte> instances) noexcept {
+    auto const added =
+        static_cast<std::int32_t>(instances.size_bytes() / instance_size());
+    if (added == 0) [[unlikely]] {
+        return;
+    }
+
+    if ((count_ + added) * layout_.stride() > capacity_) [[unlikely]] {
+        grow(growth_.next_capacity(capacity_ / instance_size(),
+                                   count_ + added) *
+             instance_size());
+    }
+
+    write(count_, instances.first(added * layout_.stride()));
+    count_ += added;
+    dense_.resize(count_, InstanceHandle::null_index);
+}
+
+inline auto VertexBufferInst::delete_instances(
+    std::span<const std::int32_t> indices) noexcept
+    -> std::vector<InstanceMove> {
+    std::vector<std::int32_t> deleted(indices.begin(), indices.end());
+    deleted.erase(std::remove_if(deleted.begin(), deleted.end(),
+                                 [this](std::int32_t index) {
+                                     return index < 0 || index >= count_;
+                                 }),
+                  deleted.end());
+    std::sort(deleted.begin(), deleted.end());
+    deleted.erase(std::unique(deleted.begin(), deleted.end()), deleted.end());
+
+    auto const new_count = count_ - static_cast<std::int32_t>(deleted.size());
+
+    for (auto const index : deleted) {
+        release_handle(index);
+    }
+
+    // holes below the new count are filled with the surviving instances past
+    // it, there are exactly as many of both
+    auto const holes_end =
+        std::lower_bound(deleted.begin(), deleted.end(), new_count);
+    auto hole = deleted.begin();
+    auto skip = holes_end;
+
+    std::vector<InstanceMove> moves;
+    moves.reserve(std::distance(deleted.begin(), holes_end));
+
+    for (std::int32_t from = new_count; hole != holes_end; from++) {
+        if (skip != deleted.end() && *skip == from) {
+            skip++;
+            continue;
+        }
+
+        relocate_handle(from, *hole);
+        moves.push_back({from, *hole});
+        hole++;
+    }
+
+    // sources are all past the new count and destinations below it, runs of
+    // consecutive moves are copied at once
+    for (std::size_t i = 0; i < moves.size();) {
+        std::int32_t run = 1;
+        while (i + run < moves.size() &&
+               moves[i + run].from == moves[i].from + run &&
+               moves[i + run].to == moves[i].to + run) {
+            run++;
+        }
+        copy_instances(moves[i].from, moves[i].to, run);
+        i += run;
+    }
+
+    count_ = new_count;
+    dense_.resize(count_);
+
+    return moves;
+}
+
+inline void VertexBufferInst::set_data(
+    std::span<const float> instances) noexcept {
+    set_data(std::as_bytes(instances));
+}
+
+inline void VertexBufferInst::set_data(
+    std::span<const std::byte> instances) noexcept {
+    for (std::int32_t index = 0; index < count_; index++) {
+        release_handle(index);
+    }
+
+    count_ = 0;
+    dense_.clear();
+    dirty_.clear();
+    append(instances);
+}
+
+template <PlainOldData T>
+void VertexBufferInst::apply(
+    const std::function<void(std::span<T> instances)>& func,
+    DriverAccessSpecifier access_specifier) noexcept {
+    if (storage_ == InstanceStorage::buffered) {
+        VertexBuffer::apply<T>(func, access_specifier);
+        return;
+    }
+
+    func(std::span{
+        reinterpret_cast<T*>(shadow_.data()),  // NOLINT (reinterpret-cast)
+        count_ * layout_.stride() / sizeof(T)});
+
+    if (access_specifier != rgl::READ_ONLY) {
+        commit({0, count_});
+    }
+}
+
+inline auto VertexBufferInst::create_instance(
+    std::span<const float> instance_data) noexcept -> InstanceHandle {
+    add_instance(instance_data);
+    return acquire_handle(count_ - 1);
+}
+
+inline auto VertexBufferInst::create_instances(
+    std::span<const float> instances) noexcept -> std::vector<InstanceHandle> {
+    auto const first = count_;
+    add_instances(instances);
+
+    std::vector<InstanceHandle> handles;
+    handles.reserve(count_ - first);
+    for (std::int32_t index = first; index < count_; index++) {
+        handles.push_back(acquire_handle(index));
+    }
+
+    return handles;
+}
+
+inline auto VertexBufferInst::destroy_instance(InstanceHandle handle) noexcept
+    -> bool {
+    auto const index = index_of(handle);
+    if (!index.has_value()) {
+        return false;
+    }
+
+    delete_instance(*index);
+    return true;
+}
+
+inline auto VertexBufferInst::destroy_instances(
+    std::span<const InstanceHandle> handles) noexcept -> std::size_t {
+    std::vector<std::int32_t> indices;
+    indices.reserve(handles.size());
+    for (auto const& handle : handles) {
+        if (auto const index = index_of(handle); index.has_value()) {
+            indices.push_back(*index);
+        }
+    }
+
+    auto const old_count = count_;
+    delete_instances(indices);
+    return static_cast<std::size_t>(old_count - count_);
+}
+
+inline void VertexBufferInst::update_instance(
+    InstanceHandle handle, std::span<const float> instance_data) noexcept {
+    if (auto const index = index_of(handle); index.has_value()) {
+        update_instance(*index, instance_data);
+    }
+}
+
+inline void VertexBufferInst::flush() noexcept {
+    if (storage_ == InstanceStorage::deferred) {
+        if (dirty_.empty()) {
+            return;
+        }
+
+        merge_ranges(dirty_, merge_gap_,
+                     [this](InstanceRange range) { upload_range(range); });
+        return;
+    }
+
+    // the current region is up to date when nothing was written since it was
+    // published, the GPU can keep reading it
+    if (storage_ != InstanceStorage::persistent || stale_[region_].empty()) {
+        return;
+    }
+
+    // every draw reading the current region has been submitted by now
+    fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    region_ = (region_ + 1) % region_count;
+    wait_region(region_);
+
+    merge_ranges(stale_[region_], 0, [this](InstanceRange range) {
+        auto const first = range.first * layout_.stride();
+        std::memcpy(mapped_ + offset() + first, shadow_.data() + first,
+                    range.count * layout_.stride());
+    });
+}
+
 }  // namespace rgl
\ No newline at end of file
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <span>
 #include <string>
 #include <string_view>
+#include <unordered_set>
 #include <vector>
 
 #include "shader_data_type.hpp"
+#include "utility.hpp"
 
 namespace rgl {
 /**
@@ -52,6 +56,11 @@ struct VertexAttribute {
  * attributes. Through this class one can specify a layout through which a
  * buffer's data can be interpreted by OpenGL.
  *
+ * Layouts are compared and hashed by format only, that is by stride and by
+ * the type, offset and element count of each attribute, attribute names are
+ * ignored. Layouts can be interned, identical formats then share a single
+ * canonical instance which can be compared by address.
+ *
  * @see vertex_attribute
  * @see shader_data_type
  * @see vertex_buffer.hpp
@@ -71,7 +80,19 @@ public:
      * @see vertex_attribute
      */
     VertexBufferLayout(std::initializer_list<VertexAttribute> attributes)
-        : m_attributes{attributes} {
+        : VertexBufferLayout{
+              std::span<const VertexAttribute>{attributes.begin(),
+                                               attributes.size()}} {}
+
+    /**
+     * @brief Construct a new vertex buffer layout object from attributes
+     * assembled at runtime.
+     *
+     * @param attributes the vertex attributes, their offsets are recomputed.
+     * @see vertex_attribute
+     */
+    explicit VertexBufferLayout(std::span<const VertexAttribute> attributes)
+        : m_attributes{attributes.begin(), attributes.end()} {
         for (auto& attribute : m_attributes) {
             attribute.offset = m_stride;
             m_stride += shader_data_type::size(attribute.type) *
@@ -120,6 +141,80 @@ public:
         -> const VertexAttribute& {
         return m_attributes[index];
     }
+
+    /**
+     * @brief Compare the formats of two vertex buffer layouts, attribute names
+     * are ignored.
+     *
+     */
+    [[nodiscard]] auto operator==(
+        const VertexBufferLayout& other) const noexcept -> bool {
+        if (m_stride != other.m_stride ||
+            m_attributes.size() != other.m_attributes.size()) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < m_attributes.size(); ++i) {
+            auto const& lhs = m_attributes[i];
+            auto const& rhs = other.m_attributes[i];
+
+            if (lhs.type != rhs.type || lhs.offset != rhs.offset ||
+                lhs.element_count != rhs.element_count) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Hash the format of the vertex buffer layout, attribute names are
+     * ignored.
+     *
+     * @return std::size_t the hash of the layout.
+     */
+    [[nodiscard]] auto hash() const noexcept -> std::size_t {
+        std::uint64_t hash{util::fnv1a(m_stride)};
+        for (const auto& [type, name, offset, element_count] : m_attributes) {
+            hash = util::fnv1a(static_cast<std::uint8_t>(type), hash);
+            hash = util::fnv1a(offset, hash);
+            hash = util::fnv1a(element_count, hash);
+        }
+
+        return static_cast<std::size_t>(hash);
+    }
+
+    /**
+     * @brief Get the canonical instance of a layout format.
+     *
+     * @details The first layout interned with a given format becomes its
+     * canonical instance, which lives until the end of the program, later
+     * layouts with the same format return it.
+     *
+     * @note Not thread-safe, like the rest of the library it is meant to be
+     * used from the thread owning the OpenGL context.
+     *
+     * @param layout the layout to intern.
+     * @return const VertexBufferLayout& the canonical instance of the format.
+     */
+    [[nodiscard]] static auto intern(const VertexBufferLayout& layout)
+        -> const VertexBufferLayout&;
+};
+
+}  // namespace rgl
+
+template <>
+struct std::hash<rgl::VertexBufferLayout> {
+    auto operator()(const rgl::VertexBufferLayout& layout) const noexcept
+        -> std::size_t {
+        return layout.hash();
+    }
 };
 
-}  // namespace rgl
\ No newline at end of file
+inline auto rgl::VertexBufferLayout::intern(const VertexBufferLayout& layout)
+    -> const VertexBufferLayout& {
+    // node-based, the canonical instances never move
+    static std::unordered_set<VertexBufferLayout> interned;
+
+    return *interned.insert(layout).first;
+}
\ No newline at end of file
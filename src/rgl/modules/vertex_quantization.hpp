@@ -0,0 +1,445 @@
+#pragma once
+
+#include "shader_data_type.hpp"
+#include "vertex_buffer_layout.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RGL_QUANTIZATION_SSE2
+#endif
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+#ifdef RGL_DEBUG
+#include <cstdio>
+#endif  // RGL_DEBUG
+
+namespace rgl::quantization {
+
+/**
+ * @brief How an attribute of a float vertex stream is quantized.
+ *
+ * @details
+ * - `position`: a vec3 quantized to 16 bit unsigned normalized integers
+ *   relative to the bounds of the mesh, stored as unorm16vec4 (8 bytes instead
+ *   of 12) with w = 1, see DequantizationConstants.
+ * - `normal`: a unit vec3 octahedrally encoded into two 16 bit signed
+ *   normalized integers, stored as snorm16vec2 (4 bytes instead of 12).
+ * - `uv`: a vec2 converted to half floats, stored as f16vec2 (4 bytes instead
+ *   of 8).
+ * - `keep`: the attribute is copied as is.
+ *
+ */
+enum class AttributeRule : std::uint8_t {
+    keep,
+    position,
+    normal,
+    uv,
+};
+
+/**
+ * @brief Constants the shaders need to reconstruct quantized positions, as
+ * `position = offset + quantized.xyz * scale`.
+ *
+ */
+struct DequantizationConstants {
+    std::array<float, 3> position_offset{};
+    std::array<float, 3> position_scale{1.0F, 1.0F, 1.0F};
+};
+
+/**
+ * @brief Result of the quantization of a vertex stream.
+ *
+ */
+struct QuantizedVertices {
+    std::vector<std::byte> vertices;
+    VertexBufferLayout layout;
+    DequantizationConstants constants;
+};
+
+/**
+ * @brief GLSL functions decoding quantized attributes, to be pasted in the
+ * vertex shaders before `main`.
+ *
+ */
+inline constexpr std::string_view glsl_decode{R"(
+vec3 rgl_decode_position(vec4 quantized, vec3 offset, vec3 scale) {
+    return offset + quantized.xyz * scale;
+}
+
+vec3 rgl_decode_octahedral(vec2 encoded) {
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+)"};
+
+/**
+ * @brief Convert a float to a half float, rounding to nearest even.
+ *
+ * @param value the float to convert.
+ * @return std::uint16_t the bits of the half float.
+ */
+[[nodiscard]] constexpr auto float_to_half(float value) noexcept
+    -> std::uint16_t {
+    auto const bits = std::bit_cast<std::uint32_t>(value);
+    std::uint32_t const sign = (bits >> 16) & 0x8000U;
+    std::uint32_t const abs = bits & 0x7FFFFFFFU;
+
+    if (abs >= 0x7F800000U) {  // infinity or NaN
+        return static_cast<std::uint16_t>(sign | 0x7C00U |
+                                          (abs > 0x7F800000U ? 0x200U : 0U));
+    }
+    if (abs >= 0x477FF000U) {  // rounds past the largest half float
+        return static_cast<std::uint16_t>(sign | 0x7C00U);
+    }
+    if (abs < 0x38800000U) {  // subnormal half float
+        if (abs < 0x33000000U) {
+            return static_cast<std::uint16_t>(sign);
+        }
+
+        std::uint32_t const shift = 126U - (abs >> 23);
+        std::uint32_t const mantissa = (abs & 0x7FFFFFU) | 0x800000U;
+        std::uint32_t const halfway = 1U << (shift - 1);
+        std::uint32_t const remainder = mantissa & ((1U << shift) - 1);
+
+        std::uint32_t result = mantissa >> shift;
+        if (remainder > halfway || (remainder == halfway && (result & 1U))) {
+            ++result;
+        }
+        return static_cast<std::uint16_t>(sign | result);
+    }
+
+    // rebias the exponent and round the mantissa from 23 to 10 bits, a carry
+    // correctly bumps the exponent
+    std::uint32_t const rounded = abs + 0xFFFU + ((abs >> 13) & 1U);
+    return static_cast<std::uint16_t>(sign | ((rounded - 0x38000000U) >> 13));
+}
+
+/**
+ * @brief Convert floats to half floats.
+ *
+ * @note Uses F16C when available.
+ *
+ * @param in the floats.
+ * @param out the half floats, at least as large as `in`.
+ */
+inline void floats_to_halves(std::span<const float> in,
+                             std::span<std::uint16_t> out) noexcept {
+    std::size_t i = 0;
+
+#ifdef __F16C__
+    for (; i + 4 <= in.size(); i += 4) {
+        __m128i const halves = _mm_cvtps_ph(_mm_loadu_ps(in.data() + i),
+                                            _MM_FROUND_TO_NEAREST_INT);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(  // NOLINT
+                             out.data() + i),
+                         halves);
+    }
+#endif  // __F16C__
+
+    for (; i < in.size(); ++i) {
+        out[i] = float_to_half(in[i]);
+    }
+}
+
+/**
+ * @brief Quantize floats to 16 bit unsigned normalized integers, after
+ * mapping `[offset, offset + scale]` to `[0, 1]`.
+ *
+ * @note Uses SSE2 when available.
+ *
+ * @param in the floats.
+ * @param offset the value mapped to 0.
+ * @param scale the extent of the values, mapped to 1, can be 0.
+ * @param out the quantized values, at least as large as `in`.
+ */
+inline void floats_to_unorm16(std::span<const float> in, float offset,
+                              float scale,
+                              std::span<std::uint16_t> out) noexcept {
+    float const inv_scale = scale > 0.0F ? 1.0F / scale : 0.0F;
+    std::size_t i = 0;
+
+#ifdef RGL_QUANTIZATION_SSE2
+    __m128 const v_offset = _mm_set1_ps(offset);
+    __m128 const v_factor = _mm_set1_ps(inv_scale * 65535.0F);
+    __m128 const v_max = _mm_set1_ps(65535.0F);
+    __m128i const bias = _mm_set1_epi32(32768);
+    __m128i const flip = _mm_set1_epi16(static_cast<short>(0x8000));
+
+    for (; i + 4 <= in.size(); i += 4) {
+        __m128 v = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(in.data() + i), v_offset),
+                              v_factor);
+        v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), v_max);
+
+        // SSE2 can only pack with signed saturation, shift the range to the
+        // signed one and flip the sign bit back afterwards
+        __m128i const ints = _mm_sub_epi32(_mm_cvtps_epi32(v), bias);
+        __m128i const packed = _mm_xor_si128(_mm_packs_epi32(ints, ints), flip);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(  // NOLINT
+                             out.data() + i),
+                         packed);
+    }
+#endif  // RGL_QUANTIZATION_SSE2
+
+    for (; i < in.size(); ++i) {
+        float const v =
+            std::clamp((in[i] - offset) * inv_scale * 65535.0F, 0.0F, 65535.0F);
+        out[i] = static_cast<std::uint16_t>(std::nearbyint(v));
+    }
+}
+
+/**
+ * @brief Quantize floats in `[-1, 1]` to 16 bit signed normalized integers.
+ *
+ * @note Uses SSE2 when available.
+ *
+ * @param in the floats, clamped to `[-1, 1]`.
+ * @param out the quantized values, at least as large as `in`.
+ */
+inline void floats_to_snorm16(std::span<const float> in,
+                              std::span<std::int16_t> out) noexcept {
+    std::size_t i = 0;
+
+#ifdef RGL_QUANTIZATION_SSE2
+    __m128 const v_min = _mm_set1_ps(-1.0F);
+    __m128 const v_max = _mm_set1_ps(1.0F);
+    __m128 const v_factor = _mm_set1_ps(32767.0F);
+
+    for (; i + 4 <= in.size(); i += 4) {
+        __m128 v = _mm_loadu_ps(in.data() + i);
+        v = _mm_mul_ps(_mm_min_ps(_mm_max_ps(v, v_min), v_max), v_factor);
+
+        __m128i const ints = _mm_cvtps_epi32(v);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(  // NOLINT
+                             out.data() + i),
+                         _mm_packs_epi32(ints, ints));
+    }
+#endif  // RGL_QUANTIZATION_SSE2
+
+    for (; i < in.size(); ++i) {
+        float const v = std::clamp(in[i], -1.0F, 1.0F) * 32767.0F;
+        out[i] = static_cast<std::int16_t>(std::nearbyint(v));
+    }
+}
+
+/**
+ * @brief Encode a unit vector on the octahedron, mapped to `[-1, 1]^2`.
+ *
+ * @param x the x component of the vector.
+ * @param y the y component of the vector.
+ * @param z the z component of the vector.
+ * @return std::array<float, 2> the encoded vector.
+ */
+[[nodiscard]] inline auto octahedral_encode(float x, float y, float z) noexcept
+    -> std::array<float, 2> {
+    float const norm = std::abs(x) + std::abs(y) + std::abs(z);
+    if (norm == 0.0F) {
+        return {0.0F, 0.0F};
+    }
+
+    x /= norm;
+    y /= norm;
+
+    if (z < 0.0F) {
+        // fold the lower hemisphere over the diagonals
+        float const sign_x = x >= 0.0F ? 1.0F : -1.0F;
+        float const sign_y = y >= 0.0F ? 1.0F : -1.0F;
+        return {(1.0F - std::abs(y)) * sign_x, (1.0F - std::abs(x)) * sign_y};
+    }
+
+    return {x, y};
+}
+
+/**
+ * @brief Quantize an interleaved float vertex stream.
+ *
+ * @details Each attribute is first gathered into contiguous arrays, one per
+ * component, which the conversion kernels process in bulk, and the results
+ * are interleaved into the quantized vertices. Attribute names are kept, so
+ * only the types and the decoding in the shaders change, see glsl_decode.
+ *
+ * @note Only vec3 positions and normals and vec2 uvs can be quantized, other
+ * attributes given a rule are kept as is. The constants are computed from the
+ * first position attribute, which should be the only one.
+ *
+ * @param vertices the float vertices, laid out according to `layout`.
+ * @param layout the layout of the float vertices.
+ * @param rules the rule of each attribute of the layout, missing rules are
+ * `keep`.
+ * @return QuantizedVertices the quantized vertices, their layout and the
+ * position dequantization constants.
+ */
+[[nodiscard]] inline auto quantize_vertices(
+    std::span<const float> vertices, const VertexBufferLayout& layout,
+    std::span<const AttributeRule> rules) -> QuantizedVertices {
+    using shader_data_type::U_Type;
+
+    auto const attributes = layout.get_attributes();
+    std::size_t const stride = layout.stride_elements();
+    std::size_t const vertex_count = stride == 0 ? 0 : vertices.size() / stride;
+
+    // decide the output type of every attribute
+    std::vector<AttributeRule> effective(attributes.size(),
+                                         AttributeRule::keep);
+    std::vector<VertexAttribute> out_attributes;
+    out_attributes.reserve(attributes.size());
+
+    for (std::size_t a = 0; a < attributes.size(); ++a) {
+        auto const& attribute = attributes[a];
+        AttributeRule const rule =
+            a < rules.size() ? rules[a] : AttributeRule::keep;
+        bool const single = attribute.element_count == 1;
+
+        bool const is_vec3_rule =
+            rule == AttributeRule::position || rule == AttributeRule::normal;
+
+        if (is_vec3_rule && single && attribute.type == U_Type::vec3) {
+            effective[a] = rule;
+        } else if (rule == AttributeRule::uv && single &&
+                   attribute.type == U_Type::vec2) {
+            effective[a] = rule;
+        }
+#ifdef RGL_DEBUG
+        else if (rule != AttributeRule::keep) {
+            std::fprintf(stderr,
+                         RGL_LINEINFO
+                         ", attribute \"%s\" has an unsupported type for its "
+                         "quantization rule, it is kept as is\n",
+                         attribute.name.c_str());
+        }
+#endif  // RGL_DEBUG
+
+        VertexAttribute out{attribute};
+        switch (effective[a]) {
+            case AttributeRule::position: out.type = U_Type::unorm16vec4; break;
+            case AttributeRule::normal: out.type = U_Type::snorm16vec2; break;
+            case AttributeRule::uv: out.type = U_Type::f16vec2; break;
+            case AttributeRule::keep: break;
+        }
+        out_attributes.push_back(std::move(out));
+    }
+
+    QuantizedVertices result{
+        {},
+        VertexBufferLayout{std::span<const VertexAttribute>{out_attributes}},
+        {}};
+    result.vertices.resize(result.layout.stride() * vertex_count);
+
+    std::vector<float> components(vertex_count);
+    std::vector<float> encoded(vertex_count * 2);
+    std::vector<std::uint16_t> packed(vertex_count * 2);
+    bool constants_set{false};
+
+    auto const gather = [&](std::size_t first, std::size_t component) {
+        for (std::size_t v = 0; v < vertex_count; ++v) {
+            components[v] = vertices[v * stride + first + component];
+        }
+    };
+    auto const scatter = [&](std::size_t out_offset, std::size_t size,
+                             std::size_t component, const void* source) {
+        auto const* bytes = static_cast<const std::byte*>(source);
+        for (std::size_t v = 0; v < vertex_count; ++v) {
+            std::memcpy(result.vertices.data() + v * result.layout.stride() +
+                            out_offset + component * size,
+                        bytes + v * size, size);
+        }
+    };
+
+    for (std::size_t a = 0; a < attributes.size(); ++a) {
+        auto const& attribute = attributes[a];
+        std::size_t const first = attribute.offset / sizeof(float);
+        std::size_t const out_offset = result.layout[a].offset;
+
+        switch (effective[a]) {
+            case AttributeRule::position: {
+                for (std::size_t c = 0; c < 3; ++c) {
+                    gather(first, c);
+
+                    float low{std::numeric_limits<float>::max()};
+                    float high{std::numeric_limits<float>::lowest()};
+                    for (float const value : components) {
+                        low = std::min(low, value);
+                        high = std::max(high, value);
+                    }
+                    if (vertex_count == 0) {
+                        low = high = 0.0F;
+                    }
+
+                    if (!constants_set) {
+                        result.constants.position_offset[c] = low;
+                        result.constants.position_scale[c] = high - low;
+                    }
+
+                    floats_to_unorm16(components,
+                                      result.constants.position_offset[c],
+                                      result.constants.position_scale[c],
+                                      packed);
+                    scatter(out_offset, sizeof(std::uint16_t), c,
+                            packed.data());
+                }
+                constants_set = true;
+                // w = 1 so the attribute can be read as a vec4 position
+                std::fill(packed.begin(), packed.end(),
+                          std::numeric_limits<std::uint16_t>::max());
+                scatter(out_offset, sizeof(std::uint16_t), 3, packed.data());
+                break;
+            }
+            case AttributeRule::normal: {
+                for (std::size_t v = 0; v < vertex_count; ++v) {
+                    float const* n = vertices.data() + v * stride + first;
+                    auto const [x, y] = octahedral_encode(n[0], n[1], n[2]);
+                    encoded[v * 2] = x;
+                    encoded[v * 2 + 1] = y;
+                }
+
+                // both components are contiguous, and so is the output
+                auto* snorm = reinterpret_cast<std::int16_t*>(  // NOLINT
+                    packed.data());
+                floats_to_snorm16(encoded, {snorm, packed.size()});
+                scatter(out_offset, sizeof(std::uint32_t), 0, packed.data());
+                break;
+            }
+            case AttributeRule::uv: {
+                for (std::size_t v = 0; v < vertex_count; ++v) {
+                    encoded[v * 2] = vertices[v * stride + first];
+                    encoded[v * 2 + 1] = vertices[v * stride + first + 1];
+                }
+
+                floats_to_halves(encoded, packed);
+                scatter(out_offset, sizeof(std::uint32_t), 0, packed.data());
+                break;
+            }
+            case AttributeRule::keep: {
+                std::size_t const size =
+                    shader_data_type::size(attribute.type) *
+                    attribute.element_count;
+                for (std::size_t v = 0; v < vertex_count; ++v) {
+                    std::memcpy(result.vertices.data() +
+                                    v * result.layout.stride() + out_offset,
+                                vertices.data() + v * stride + first, size);
+                }
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+}  // namespace rgl::quantization
\ No newline at end of file
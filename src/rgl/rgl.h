@@ -1,13 +1,28 @@
 #pragma once
 
+#include "modules/batch_renderer.hpp"
+#include "modules/buffer_arena.hpp"
 #include "modules/cube_map.hpp"
 #include "modules/frame_buffer.hpp"
+#include "modules/frustum_culler.hpp"
 #include "modules/index_buffer.hpp"
+#include "modules/indirect_buffer.hpp"
+#include "modules/mesh_lod.hpp"
+#include "modules/mesh_optimization.hpp"
+#include "modules/meshlet.hpp"
 #include "modules/shader.hpp"
+#include "modules/shader_family.hpp"
+#include "modules/shader_preprocessor.hpp"
+#include "modules/shader_reflection.hpp"
+#include "modules/shader_storage_buffer.hpp"
+#include "modules/shader_watcher.hpp"
 #include "modules/texture.hpp"
 #include "modules/uniform_buffer.hpp"
+#include "modules/uniform_shadow.hpp"
 #include "modules/vertex_array.hpp"
+#include "modules/vertex_array_cache.hpp"
 #include "modules/vertex_buffer.hpp"
 #include "modules/vertex_buffer_inst.hpp"
 #include "modules/vertex_buffer_layout.hpp"
+#include "modules/vertex_quantization.hpp"
 #include "modules/render_buffer.hpp"
\ No newline at end of file